@@ -0,0 +1,655 @@
+#include "generate.h"
+#include "demobench.h"
+#include "instancer.h"
+#include "fontcache.h"
+#include "loadorder.h"
+#include "mirrors.h"
+#include "mirrorserver.h"
+#include "selection.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+using json=nlohmann::json;
+
+// doom_instancer_bench: times the launcher's hot paths against synthetic
+// data and prints the results as JSON, one entry per case, so numbers can
+// be compared across releases.
+//
+//   doom_instancer_bench [--quick] [--filter <text>] [--output <file>]
+//       [--workdir <dir>] [--keep] [--idgames-json <file>] [--trace <file>]
+//       [--archive-mb <size>]
+//
+// --archive-mb sets how much pool data the export/import cases move, so
+// they can be run against multi-GB instances (e.g. --archive-mb 4096).
+
+struct options_t {
+	bool quick = false;
+	bool keep = false;
+	std::string filter;
+	path output;
+	path workdir;
+	path idgames_json;
+	path trace_file;
+	std::size_t archive_mb = 0; // 0 picks a size to suit --quick
+};
+
+class Bench {
+	public:
+	Bench(const options_t& options) : options(options) {}
+
+	// body runs once per iteration and returns how long the part worth
+	// measuring took, so setup and cleanup can stay outside the timing.
+	// Cases that move `bytes` of data per iteration also report MB/s.
+	void run(const std::string& name, const json& params, int iterations,
+			const std::function<double()>& body, std::uintmax_t bytes = 0) {
+		if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+			return;
+		if (options.quick) iterations = std::max(1, iterations / 4);
+		std::vector<double> samples{};
+		body(); // warm up
+		for (int i = 0; i < iterations; i++) samples.push_back(body());
+		std::sort(samples.begin(), samples.end());
+
+		double total = 0;
+		for (double sample : samples) total += sample;
+		auto percentile = [&](double p) {
+			return samples[std::min<std::size_t>(samples.size() - 1, p * samples.size())];
+		};
+		json result = {
+			{"name", name},
+			{"params", params},
+			{"iterations", iterations},
+			{"min_ms", samples.front()},
+			{"mean_ms", total / samples.size()},
+			{"p50_ms", percentile(0.50)},
+			{"p99_ms", percentile(0.99)},
+			{"max_ms", samples.back()}
+		};
+		if (bytes) result["p50_mb_per_s"] = bytes / 1e6 / (percentile(0.50) / 1000);
+		std::fprintf(stderr, "%-28s %-36s p50 %10.3fms  p99 %10.3fms", name.c_str(),
+				params.dump().c_str(), (double)result["p50_ms"], (double)result["p99_ms"]);
+		if (bytes) std::fprintf(stderr, "  %8.1fMB/s", (double)result["p50_mb_per_s"]);
+		std::fprintf(stderr, "\n");
+		results.push_back(result);
+	}
+
+	// For cases that drive a stand-in and can tell whether it behaved;
+	// failures are listed in the report and fail the whole run.
+	void check(bool ok, const std::string& what) {
+		if (ok) return;
+		std::fprintf(stderr, "check failed: %s\n", what.c_str());
+		failures.push_back(what);
+	}
+	[[nodiscard]] bool failed() const { return !failures.empty(); }
+
+	[[nodiscard]] json report() const {
+		char timestr[64];
+		std::time_t now = std::time(nullptr);
+		std::strftime(timestr, sizeof(timestr), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+		return {
+			{"suite", "doom_instancer_bench"},
+			{"schema", 1},
+			{"timestamp", timestr},
+			{"quick", options.quick},
+			{"hardware_concurrency", std::thread::hardware_concurrency()},
+			{"results", results},
+			{"failures", failures}
+		};
+	}
+
+	private:
+	options_t options;
+	json results = json::array();
+	json failures = json::array();
+};
+
+template <typename F> static double time_ms(F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+}
+
+static void headless_imgui() {
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.IniFilename = nullptr;
+	io.LogFilename = nullptr;
+	io.DisplaySize = ImVec2(1920, 1080);
+	io.DeltaTime = 1.0f / 60.0f;
+	#if IMGUI_VERSION_NUM >= 19200
+	// Glyphs are baked on demand; with no renderer the textures are simply
+	// never uploaded.
+	io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+	#else
+	unsigned char* pixels;
+	int width, height;
+	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	#endif
+}
+
+// The instancer's UI state is private; this is the one way in, so the
+// suite can pick a view, an instance and a save name without input.
+class InstancerBench {
+	public:
+	static void show(GZDoomInstancer& instancer, GZDoomInstancer::VIEW view) {
+		instancer.current_view = view;
+	}
+	static void select_instance(GZDoomInstancer& instancer, int index) {
+		instancer.current_instance_index = index;
+	}
+	static void set_new_instance_name(GZDoomInstancer& instancer, const std::string& name) {
+		memset(instancer.new_instance_name, 0, sizeof(instancer.new_instance_name));
+		strncpy(instancer.new_instance_name, name.c_str(),
+				sizeof(instancer.new_instance_name) - 1);
+	}
+};
+
+static double frame_ms(GZDoomInstancer& instancer) {
+	return time_ms([&]() {
+		ImGui::NewFrame();
+		instancer.process();
+		ImGui::Render();
+	});
+}
+
+static std::size_t instance_index(GZDoomInstancer& instancer, const path& instance) {
+	const std::vector<path> instances = instancer.list_instances();
+	return std::distance(instances.begin(),
+			std::find(instances.begin(), instances.end(), instance));
+}
+
+static void bench_scans(Bench& bench, const path& workdir, const options_t& options) {
+	for (std::size_t files : {100ul, 1000ul, 10000ul}) {
+		if (options.quick && files > 1000) continue;
+		std::mt19937 rng(files);
+		const path rootdir = workdir / ("scan-" + std::to_string(files));
+		make_pool(rootdir, files, 4096, rng);
+		make_instances(rootdir, files / 10, make_iwad(rootdir, rng), {}, 0, rng);
+		GZDoomInstancer instancer(rootdir, true);
+
+		bench.run("list_available_pwads", {{"files", files}}, 40, [&]() {
+			return time_ms([&]() { (void)instancer.list_available_pwads(); });
+		});
+		bench.run("list_instances", {{"instances", files / 10}}, 40, [&]() {
+			return time_ms([&]() { (void)instancer.list_instances(); });
+		});
+	}
+}
+
+static void bench_pool(Bench& bench, const path& workdir, const options_t& options) {
+	const std::size_t files = options.quick ? 1000 : 10000;
+	std::mt19937 rng(files + 2);
+	// A big shared layer under a small per-user one.
+	const path shared = workdir / "layered-shared";
+	const path rootdir = workdir / "layered-user";
+	const std::vector<path> shared_files = make_pool(shared, files, 256, rng);
+	make_pool(rootdir, files / 100, 256, rng);
+	std::filesystem::create_directories(rootdir / "iwads");
+	std::ofstream(rootdir / "pools.json") << json::array({shared.string()}) << std::endl;
+	PoolStack pool(rootdir);
+	pool.refresh();
+
+	const json params = {{"layers", 2}, {"files", files + files / 100}};
+	bench.run("pool_refresh_unchanged", params, 200, [&]() {
+		return time_ms([&]() { pool.refresh(); });
+	});
+	int added = 0;
+	bench.run("pool_refresh_top_layer", params, 100, [&]() {
+		const path file = rootdir / "pwads" / ("added-" + std::to_string(added++) + ".wad");
+		std::ofstream(file) << "PWAD";
+		const double ms = time_ms([&]() { pool.refresh(); });
+		std::filesystem::remove(file);
+		pool.refresh();
+		return ms;
+	});
+	bench.run("pool_resolve", {{"layers", 2}, {"lookups", shared_files.size()}}, 50, [&]() {
+		return time_ms([&]() {
+			for (const path& file : shared_files)
+				(void)pool.resolve(PoolStack::PWADS, file.filename().string());
+		});
+	});
+}
+
+static void bench_instances(Bench& bench, const path& workdir) {
+	for (std::size_t pwads : {10ul, 100ul, 1000ul}) {
+		std::mt19937 rng(pwads);
+		const path rootdir = workdir / ("instance-" + std::to_string(pwads));
+		const std::vector<path> pool = make_pool(rootdir, pwads, 1024, rng);
+		const path instance = make_instances(rootdir, 1, make_iwad(rootdir, rng),
+				pool, pwads, rng)[0];
+		GZDoomInstancer instancer(rootdir, true);
+		InstancerBench::select_instance(instancer, instance_index(instancer, instance));
+
+		bench.run("load_instance", {{"pwads", pwads}}, 100, [&]() {
+			return time_ms([&]() { instancer.load_instance(); });
+		});
+
+		int saved = 0;
+		bench.run("save_instance", {{"pwads", pwads}}, 100, [&]() {
+			// A fresh name each time, so save_instance never asks to overwrite.
+			const std::string name = "saved-" + std::to_string(saved++);
+			InstancerBench::set_new_instance_name(instancer, name);
+			const double ms = time_ms([&]() { instancer.save_instance(); });
+			std::filesystem::remove_all(rootdir / "instances" / name);
+			return ms;
+		});
+	}
+}
+
+static void bench_archives(Bench& bench, const path& workdir, const options_t& options) {
+	struct archive_t { std::size_t files; std::size_t file_size; };
+	for (archive_t archive : {archive_t{256, 16 << 10}, archive_t{16, 4 << 20}}) {
+		if (options.quick && archive.file_size > (1 << 20)) archive.files = 4;
+		std::mt19937 rng(archive.files);
+		const path rootdir = workdir / ("extract-" + std::to_string(archive.files));
+		const path zip = workdir / ("extract-" + std::to_string(archive.files) + ".zip");
+		make_zip(zip, archive.files, archive.file_size, rng);
+		GZDoomInstancer instancer(rootdir, true);
+
+		const json params = {{"files", archive.files}, {"file_size", archive.file_size}};
+		bench.run("iga_extract", params, 12, [&]() {
+			const double ms = time_ms([&]() { instancer.iga_extract(zip); });
+			std::filesystem::remove_all(rootdir / "pwads");
+			std::filesystem::create_directory(rootdir / "pwads");
+			return ms;
+		}, archive.files * archive.file_size);
+	}
+
+	// The pool is split over 64 PWADs, so multi-GB runs still have files
+	// big enough to take one block per core.
+	const std::size_t archive_mb = options.archive_mb ? options.archive_mb :
+		options.quick ? 4 : 64;
+	const int iterations = archive_mb >= 1024 ? 2 : 8;
+	std::mt19937 rng(7);
+	const path rootdir = workdir / "export";
+	const std::vector<path> pool = make_pool(rootdir, 64, (archive_mb << 20) / 64, rng);
+	const path instance = make_instances(rootdir, 1, make_iwad(rootdir, rng), pool,
+			pool.size(), rng)[0];
+	HashCache hashes(rootdir / "cache" / "hashes.json");
+	const path archive = workdir / "export.zip";
+	export_result_t exported = export_instance(rootdir, instance, archive, true, &hashes);
+	const json params = {{"pwads", pool.size()}, {"archive_mb", archive_mb},
+		{"include_pool", true}};
+	bench.run("export_instance", params, iterations, [&]() {
+		return time_ms([&]() {
+			exported = export_instance(rootdir, instance, archive, true, &hashes);
+		});
+	}, exported.input_bytes);
+
+	// Into an empty rootdir, so every pool file is extracted rather than
+	// matched by hash.
+	const path import_root = workdir / "import";
+	HashCache import_hashes(import_root / "cache" / "hashes.json");
+	bench.run("import_instance", params, iterations, [&]() {
+		std::filesystem::remove_all(import_root / "instances");
+		std::filesystem::remove_all(import_root / "pwads");
+		std::filesystem::remove_all(import_root / "iwads");
+		std::filesystem::create_directories(import_root / "instances");
+		std::filesystem::create_directories(import_root / "pwads");
+		std::filesystem::create_directories(import_root / "iwads");
+		return time_ms([&]() {
+			(void)import_instance(import_root, archive, &import_hashes);
+		});
+	}, exported.input_bytes);
+	std::filesystem::remove(archive);
+}
+
+static void bench_json(Bench& bench, const options_t& options) {
+	std::mt19937 rng(3);
+	if (!options.idgames_json.empty()) {
+		std::ifstream i(options.idgames_json);
+		std::stringstream recorded;
+		recorded << i.rdbuf();
+		const std::string listing = recorded.str();
+		const json params = {{"recorded", options.idgames_json.filename().string()}};
+		bench.run("iga_parse_files", params, 50, [&]() {
+			return time_ms([&]() { (void)GZDoomInstancer::iga_parse_files(listing); });
+		});
+	}
+	for (std::size_t files : {100ul, 1000ul, 10000ul}) {
+		if (options.quick && files > 1000) continue;
+		const std::string listing = make_idgames_files(files, rng);
+		bench.run("iga_parse_files", {{"files", files}, {"bytes", listing.size()}}, 50, [&]() {
+			return time_ms([&]() { (void)GZDoomInstancer::iga_parse_files(listing); });
+		});
+	}
+	const std::string dirs = make_idgames_dirs(1000, rng);
+	bench.run("iga_parse_dirs", {{"dirs", 1000}, {"bytes", dirs.size()}}, 50, [&]() {
+		return time_ms([&]() { (void)GZDoomInstancer::iga_parse_dirs(dirs); });
+	});
+	const std::string details = make_idgames_details(rng);
+	bench.run("iga_parse_details", {{"bytes", details.size()}}, 200, [&]() {
+		return time_ms([&]() { (void)GZDoomInstancer::iga_parse_details(details); });
+	});
+}
+
+// The editor's PWAD selection and load order at pool sizes far beyond
+// what's worth writing to disk; only the names matter here.
+static void bench_selection(Bench& bench, const path& workdir, const options_t& options) {
+	const std::size_t files = options.quick ? 10000 : 100000;
+	std::mt19937 rng(files + 5);
+	const std::vector<path> pool = make_pool_names(workdir / "selection", files, rng);
+	std::vector<std::size_t> all(files);
+	for (std::size_t i = 0; i < files; i++) all[i] = i;
+	// A tenth of the pool, as a filter would leave it.
+	std::vector<std::size_t> matching{};
+	for (std::size_t i = 0; i < files; i++)
+		if (pool[i].filename().string().find("5-") != std::string::npos) matching.push_back(i);
+
+	Selection selection;
+	bench.run("selection_shift_click", {{"pool_files", files}}, 50, [&]() {
+		selection.reset(files);
+		return time_ms([&]() {
+			selection.click(all, 0, false, false);
+			selection.click(all, files - 1, false, true);
+		});
+	});
+	bench.run("selection_select_matching", {{"pool_files", files},
+			{"matching", matching.size()}}, 50, [&]() {
+		selection.reset(files);
+		return time_ms([&]() { selection.select_all(matching); });
+	});
+
+	for (std::size_t selected : {1000ul, 10000ul, 100000ul}) {
+		if (selected > files) continue;
+		std::vector<path> pwads{};
+		for (std::size_t i = 0; i < selected; i++) pwads.push_back(pool[i * (files / selected)]);
+		// Activate onto a load order that already holds every other file,
+		// and deactivate from one holding the whole pool.
+		std::vector<path> existing{};
+		for (std::size_t i = 1; i < files; i += 2) existing.push_back(pool[i]);
+		LoadOrder load_order;
+		const json params = {{"pool_files", files}, {"selected", selected}};
+		bench.run("load_order_activate", params, 20, [&]() {
+			load_order.assign(existing);
+			return time_ms([&]() { load_order.activate(pwads); });
+		});
+		bench.run("load_order_deactivate", params, 20, [&]() {
+			load_order.assign(pool);
+			return time_ms([&]() { load_order.deactivate(pwads); });
+		});
+	}
+}
+
+// Startup font work as main() does it: add the UI font, build or load the
+// atlas, then produce the RGBA pixels the OpenGL backend uploads. Cold runs
+// rasterise from scratch, warm ones load the atlas cached by the last run.
+// Run it from the build directory, where ProggyClean.ttf is copied.
+static void bench_fonts(Bench& bench, const path& workdir) {
+	const path cache_file = workdir / "fonts" / "fontatlas.bin";
+	auto startup_ms = [&]() {
+		ImFontAtlas atlas;
+		return time_ms([&]() {
+			add_ui_font(&atlas);
+			build_font_atlas(&atlas, cache_file);
+			unsigned char* pixels;
+			int width, height;
+			atlas.GetTexDataAsRGBA32(&pixels, &width, &height);
+		});
+	};
+	const json params = {{"font", std::filesystem::exists("ProggyClean.ttf") ?
+		"ProggyClean.ttf" : "built-in"}, {"size", 26}};
+	bench.run("font_atlas_cold", params, 20, [&]() {
+		std::filesystem::remove(cache_file);
+		return startup_ms();
+	});
+	bench.run("font_atlas_warm", params, 20, startup_ms);
+}
+
+// The demo benchmark queue against a GZDoom stand-in, which checks the
+// timedemo parsing, that the slots really run side by side and that
+// cancel() takes down runs in progress instead of waiting them out.
+static void bench_demos(Bench& bench, const path& workdir) {
+	std::mt19937 rng(11);
+	const path rootdir = workdir / "demos";
+	const std::vector<path> pool = make_pool(rootdir, 8, 1024, rng);
+	const std::vector<path> instances = make_instances(rootdir, 4, make_iwad(rootdir, rng),
+			pool, 4, rng);
+	const double run_seconds = 0.1, stuck_seconds = 60;
+	make_gzdoom_standin(rootdir / "bin" / "gzdoom", 2134, 1530, run_seconds);
+	make_gzdoom_standin(rootdir / "bin" / "gzdoom-stuck", 2134, 1530, stuck_seconds);
+	DemoBenchmark demos(rootdir / "cache" / "benchmarks.json", rootdir / "logs",
+			rootdir / "cache" / "benchmark");
+	DemoBenchmark::job_t job{
+		.gzdoom_path = rootdir / "bin" / "gzdoom",
+		.instances = instances,
+		.demo = "demo1",
+		.extra_args = "-nosound -nomusic",
+		.repeats = 2,
+		.parallel = 1,
+		.pool = nullptr
+	};
+	const std::size_t runs = instances.size() * job.repeats;
+	auto wait = [&]() {
+		while (demos.running()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	};
+
+	for (int parallel : {1, 4}) {
+		job.parallel = parallel;
+		bench.run("demo_queue", {{"runs", runs}, {"parallel", parallel}}, 4, [&]() {
+			demos.clear();
+			const double ms = time_ms([&]() {
+				demos.start(job);
+				wait();
+			});
+			std::size_t parsed = 0;
+			for (const DemoBenchmark::run_t& run : demos.results())
+				if (run.ok && run.exit_code == 0 && run.gametics == 2134 &&
+						run.realtics == 1530 && run.fps == 48.8) parsed++;
+			bench.check(parsed == runs, "demo_queue parsed " + std::to_string(parsed) +
+					" of " + std::to_string(runs) + " timedemo results");
+			if (parallel > 1)
+				bench.check(ms < runs * run_seconds * 1000,
+						"demo_queue took " + std::to_string(ms) + "ms with " +
+						std::to_string(parallel) + " slots, no faster than one");
+			return ms;
+		});
+	}
+
+	job.gzdoom_path = rootdir / "bin" / "gzdoom-stuck";
+	job.parallel = 4;
+	bench.run("demo_cancel", {{"runs", runs}, {"parallel", job.parallel}}, 4, [&]() {
+		demos.clear();
+		demos.start(job);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		const double ms = time_ms([&]() {
+			demos.cancel();
+			wait();
+		});
+		std::size_t started = 0;
+		for (const DemoBenchmark::run_t& run : demos.results())
+			if (run.finished) started++;
+		bench.check(ms < stuck_seconds * 1000, "demo_cancel waited for the stand-in to exit");
+		bench.check(started <= (std::size_t)job.parallel,
+				"demo_cancel started " + std::to_string(started) + " runs after cancel()");
+		return ms;
+	});
+}
+
+// MirrorSet against stand-in mirrors on localhost, listed through
+// DOOM_INSTANCER_MIRRORS: a race the quicker mirror has to win, a failover
+// away from each kind of broken mirror, and stop() during a stalled probe.
+// Every download has to end with the whole payload on disk.
+static void bench_mirrors(Bench& bench, const path& workdir, const options_t& options) {
+	std::mt19937 rng(13);
+	const std::size_t payload_bytes = options.quick ? 1 << 20 : 16 << 20;
+	std::string payload(payload_bytes, '\0');
+	for (char& c : payload) c = rng();
+	const path rootdir = workdir / "mirrors";
+	std::filesystem::create_directories(rootdir);
+	const path output = rootdir / "download.zip";
+	auto config = [&](const std::string& name, bool race, int stall_timeout) {
+		const path file = rootdir / (name + ".json");
+		std::ofstream(file) << json{{"race", race}, {"stall_timeout", stall_timeout},
+			{"connect_timeout", 1}} << std::endl;
+		return file;
+	};
+	auto use = [](const std::vector<const MirrorServer*>& servers) {
+		std::string urls{};
+		for (const MirrorServer* server : servers) urls += server->url() + " ";
+		setenv("DOOM_INSTANCER_MIRRORS", urls.c_str(), 1);
+	};
+	auto downloaded = [&]() {
+		std::ifstream i(output, std::ios::binary);
+		std::stringstream contents;
+		contents << i.rdbuf();
+		return contents.str() == payload;
+	};
+	auto download = [&](const path& config_file, const std::string& name,
+			const MirrorServer& expected, int failovers) {
+		MirrorSet mirrors(config_file);
+		MirrorSet::result_t result{};
+		const double ms = time_ms([&]() {
+			result = mirrors.download("levels/doom2/bench.zip", output);
+		});
+		bench.check(result.ok && downloaded(), name + " did not get the whole file: " +
+				result.error);
+		bench.check(result.mirror.starts_with(expected.url()), name + " finished on " +
+				result.mirror + ", expected " + expected.url());
+		bench.check(result.failovers == failovers, name + " failed over " +
+				std::to_string(result.failovers) + " times, expected " + std::to_string(failovers));
+		return ms;
+	};
+
+	{
+		// Listed first, so it's tried first, but answers later.
+		MirrorServer slow(payload, MirrorServer::MODE_OK, 300);
+		MirrorServer fast(payload, MirrorServer::MODE_OK);
+		use({&slow, &fast});
+		const path file = config("race", true, 10);
+		bench.run("mirror_race", {{"bytes", payload_bytes}}, 8, [&]() {
+			return download(file, "mirror_race", fast, 0);
+		}, payload_bytes);
+	}
+
+	struct fault_t {
+		const char* name;
+		MirrorServer::MODE broken;
+		MirrorServer::MODE fallback;
+	};
+	const path file = config("failover", false, 1);
+	for (const fault_t& fault : {
+			fault_t{"503", MirrorServer::MODE_FAIL, MirrorServer::MODE_OK},
+			fault_t{"cut", MirrorServer::MODE_CUT, MirrorServer::MODE_OK},
+			fault_t{"stall", MirrorServer::MODE_STALL, MirrorServer::MODE_OK},
+			fault_t{"cut_no_range", MirrorServer::MODE_CUT, MirrorServer::MODE_NO_RANGE},
+			fault_t{"416_at_end", MirrorServer::MODE_NO_END, MirrorServer::MODE_OK}}) {
+		MirrorServer broken(payload, fault.broken);
+		MirrorServer fallback(payload, fault.fallback);
+		use({&broken, &fallback});
+		// A 503 never sends a byte, so moving on isn't a failover; a file
+		// that arrived whole before the error is finished by the 416.
+		const bool sent_data = fault.broken != MirrorServer::MODE_FAIL;
+		const MirrorServer& expected = fault.broken == MirrorServer::MODE_NO_END ?
+			broken : fallback;
+		const std::string name = std::string("mirror_failover_") + fault.name;
+		bench.run("mirror_failover", {{"fault", fault.name}, {"bytes", payload_bytes}}, 4,
+				[&]() { return download(file, name, expected, sent_data ? 1 : 0); },
+				payload_bytes);
+	}
+
+	{
+		MirrorServer stalled(payload, MirrorServer::MODE_STALL);
+		use({&stalled});
+		const path file = config("probe", true, 30);
+		bench.run("mirror_probe_stop", {{"stall_timeout", 30}}, 4, [&]() {
+			MirrorSet mirrors(file);
+			mirrors.start();
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			const double ms = time_ms([&]() { mirrors.stop(); });
+			bench.check(ms < 1000, "mirror_probe_stop waited " + std::to_string(ms) +
+					"ms for a stalled probe");
+			return ms;
+		});
+	}
+	unsetenv("DOOM_INSTANCER_MIRRORS");
+}
+
+static void bench_frames(Bench& bench, const path& workdir, const options_t& options) {
+	for (std::size_t files : {1000ul, 10000ul}) {
+		if (options.quick && files > 1000) continue;
+		std::mt19937 rng(files + 1);
+		const path rootdir = workdir / ("frames-" + std::to_string(files));
+		const std::vector<path> pool = make_pool(rootdir, files, 512, rng);
+		const std::vector<path> instances = make_instances(rootdir, files / 10,
+				make_iwad(rootdir, rng), pool, 50, rng);
+		GZDoomInstancer instancer(rootdir, true);
+		InstancerBench::select_instance(instancer, instance_index(instancer, instances[0]));
+
+		InstancerBench::show(instancer, GZDoomInstancer::MANAGER_LAUNCHER_VIEW);
+		bench.run("frame_manager_view", {{"instances", instances.size()}}, 120, [&]() {
+			return frame_ms(instancer);
+		});
+
+		instancer.load_instance();
+		InstancerBench::show(instancer, GZDoomInstancer::EDITOR_VIEW);
+		bench.run("frame_editor_view", {{"pool_files", files}, {"active_pwads", 50}}, 120,
+				[&]() { return frame_ms(instancer); });
+	}
+}
+
+int main(int argc, char** argv) {
+	options_t options{};
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+				std::exit(EXIT_FAILURE);
+			}
+			return argv[++i];
+		};
+		if (arg == "--quick") options.quick = true;
+		else if (arg == "--keep") options.keep = true;
+		else if (arg == "--filter") options.filter = value();
+		else if (arg == "--output") options.output = value();
+		else if (arg == "--workdir") options.workdir = value();
+		else if (arg == "--idgames-json") options.idgames_json = value();
+		else if (arg == "--trace") options.trace_file = value();
+		else if (arg == "--archive-mb") options.archive_mb = std::stoul(value());
+		else {
+			std::fprintf(stderr, "usage: %s [--quick] [--filter <text>] [--output <file>] " \
+					"[--workdir <dir>] [--keep] [--idgames-json <file>] [--trace <file>] " \
+					"[--archive-mb <size>]\n",
+					argv[0]);
+			return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	const bool own_workdir = options.workdir.empty();
+	if (own_workdir)
+		options.workdir = std::filesystem::temp_directory_path() /
+			("doom_instancer_bench-" + std::to_string(getpid()));
+	std::filesystem::create_directories(options.workdir);
+	if (!options.trace_file.empty()) trace::set_enabled(true);
+
+	headless_imgui();
+	Bench bench(options);
+	bench_scans(bench, options.workdir, options);
+	bench_pool(bench, options.workdir, options);
+	bench_instances(bench, options.workdir);
+	bench_archives(bench, options.workdir, options);
+	bench_json(bench, options);
+	bench_selection(bench, options.workdir, options);
+	bench_fonts(bench, options.workdir);
+	bench_demos(bench, options.workdir);
+	bench_mirrors(bench, options.workdir, options);
+	bench_frames(bench, options.workdir, options);
+	ImGui::DestroyContext();
+
+	const json report = bench.report();
+	if (options.output.empty()) std::cout << report.dump(1, '\t') << std::endl;
+	else std::ofstream(options.output) << report.dump(1, '\t') << std::endl;
+	if (!options.trace_file.empty()) trace::export_chrome(options.trace_file);
+	if (own_workdir && !options.keep) std::filesystem::remove_all(options.workdir);
+	return bench.failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+#include "generate.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <zip.h>
+using json=nlohmann::json;
+
+static std::vector<char> make_data(std::size_t size, std::mt19937& rng) {
+	// Runs of repeated bytes between random ones compress roughly 2:1.
+	std::vector<char> data(size);
+	std::size_t i = 0;
+	while (i < size) {
+		const std::size_t run = std::min<std::size_t>(size - i, 1 + rng() % 16);
+		const char value = (char)rng();
+		if (rng() & 1) std::memset(data.data() + i, value, run);
+		else for (std::size_t j = 0; j < run; j++) data[i + j] = (char)rng();
+		i += run;
+	}
+	return data;
+}
+
+static std::string random_name(std::mt19937& rng, std::size_t length) {
+	static const char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+	std::string name(length, ' ');
+	for (char& c : name) c = letters[rng() % (sizeof(letters) - 1)];
+	return name;
+}
+
+static void put32(std::ofstream& o, std::uint32_t value) {
+	const unsigned char bytes[4] = {
+		(unsigned char)value, (unsigned char)(value >> 8),
+		(unsigned char)(value >> 16), (unsigned char)(value >> 24)
+	};
+	o.write((const char*)bytes, 4);
+}
+
+void make_wad(const path& file, std::size_t lumps, std::size_t lump_size,
+		std::mt19937& rng) {
+	static const char* map_lumps[] = {
+		"THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+		"SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP"
+	};
+	std::vector<std::string> names{};
+	for (std::size_t i = 0; names.size() < lumps; i++) {
+		if (i % 2 == 0 && names.size() + 11 <= lumps) {
+			char map[9];
+			snprintf(map, sizeof(map), "MAP%02zu", (i / 2) % 32 + 1);
+			names.push_back(map);
+			for (const char* lump : map_lumps) names.push_back(lump);
+		} else names.push_back("LMP" + random_name(rng, 5));
+	}
+
+	std::ofstream o(file, std::ios::binary);
+	o.write("PWAD", 4);
+	put32(o, names.size());
+	put32(o, 12 + names.size() * lump_size);
+	for (std::size_t i = 0; i < names.size(); i++) {
+		const std::vector<char> data = make_data(lump_size, rng);
+		o.write(data.data(), data.size());
+	}
+	for (std::size_t i = 0; i < names.size(); i++) {
+		put32(o, 12 + i * lump_size);
+		put32(o, lump_size);
+		char name[8] = {};
+		std::memcpy(name, names[i].c_str(), std::min<std::size_t>(8, names[i].size()));
+		o.write(name, 8);
+	}
+}
+
+std::vector<path> make_pool(const path& rootdir, std::size_t files,
+		std::size_t file_size, std::mt19937& rng) {
+	std::filesystem::create_directories(rootdir / "pwads");
+	const std::size_t lumps = 24;
+	std::vector<path> pool{};
+	for (std::size_t i = 0; i < files; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "pwad%06zu-", i);
+		const path file = rootdir / "pwads" / (name + random_name(rng, 6) + ".wad");
+		make_wad(file, lumps, std::max<std::size_t>(1, file_size / lumps), rng);
+		pool.push_back(file);
+	}
+	std::sort(pool.begin(), pool.end());
+	return pool;
+}
+
+std::vector<path> make_pool_names(const path& rootdir, std::size_t files, std::mt19937& rng) {
+	std::vector<path> pool{};
+	pool.reserve(files);
+	for (std::size_t i = 0; i < files; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "pwad%06zu-", i);
+		pool.push_back(rootdir / "pwads" / (name + random_name(rng, 6) + ".wad"));
+	}
+	std::sort(pool.begin(), pool.end());
+	return pool;
+}
+
+path make_iwad(const path& rootdir, std::mt19937& rng) {
+	std::filesystem::create_directories(rootdir / "iwads");
+	const path iwad = rootdir / "iwads" / "doom2.wad";
+	make_wad(iwad, 64, 1024, rng);
+	return iwad;
+}
+
+std::vector<path> make_instances(const path& rootdir, std::size_t count,
+		const path& iwad, const std::vector<path>& pool, std::size_t pwads,
+		std::mt19937& rng) {
+	std::vector<path> instances{};
+	for (std::size_t i = 0; i < count; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "bench-%05zu", i);
+		const path instance = rootdir / "instances" / name;
+		std::filesystem::create_directories(instance / "save");
+
+		std::vector<path> chosen = pool;
+		std::shuffle(chosen.begin(), chosen.end(), rng);
+		chosen.resize(std::min(pwads, chosen.size()));
+
+		json j;
+		j["iwad_path"] = iwad;
+		j["pwad_paths"] = json::array();
+		for (const path& pwad : chosen) j["pwad_paths"].push_back(pwad);
+		std::ofstream(instance / "config.json") << j << std::endl;
+		instances.push_back(instance);
+	}
+	return instances;
+}
+
+void make_zip(const path& archive, std::size_t files, std::size_t file_size,
+		std::mt19937& rng) {
+	std::filesystem::remove(archive);
+	int err;
+	zip_t* z = zip_open(archive.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &err);
+	if (!z) return;
+	// libzip reads the buffers when the archive is closed.
+	std::vector<std::vector<char>> buffers{};
+	buffers.reserve(files + 1);
+	auto add = [&](const std::string& name, std::vector<char> data) {
+		buffers.push_back(std::move(data));
+		zip_source_t* source = zip_source_buffer(z, buffers.back().data(),
+				buffers.back().size(), 0);
+		if (source && zip_file_add(z, name.c_str(), source, ZIP_FL_OVERWRITE) < 0)
+			zip_source_free(source);
+	};
+	for (std::size_t i = 0; i < files; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "extract%04zu.wad", i);
+		add(name, make_data(file_size, rng));
+	}
+	const std::string readme = "Synthetic archive for doom_instancer_bench.\n";
+	add("readme.txt", std::vector<char>(readme.begin(), readme.end()));
+	zip_close(z);
+}
+
+static json idgames_file(std::size_t id, std::mt19937& rng) {
+	const std::string name = random_name(rng, 8);
+	return {
+		{"id", id},
+		{"title", "Synthetic Megawad " + name},
+		{"dir", "levels/doom2/Ports/" + name.substr(0, 1) + "/"},
+		{"filename", name + ".zip"},
+		{"size", 1000 + rng() % 50000000},
+		{"age", 800000000 + rng() % 900000000},
+		{"date", "2003-06-14"},
+		{"author", "Author " + random_name(rng, 6)},
+		{"email", random_name(rng, 6) + "@example.com"},
+		{"description", "A " + std::to_string(1 + rng() % 32) + " map set. " +
+			std::string(200 + rng() % 400, 'x')},
+		{"rating", (rng() % 500) / 100.0},
+		{"votes", rng() % 300},
+		{"url", "https://www.doomworld.com/idgames/?id=" + std::to_string(id)},
+		{"idgamesurl", "idgames://" + std::to_string(id)}
+	};
+}
+
+std::string make_idgames_files(std::size_t files, std::mt19937& rng) {
+	json j;
+	j["content"]["file"] = json::array();
+	for (std::size_t i = 0; i < files; i++)
+		j["content"]["file"].push_back(idgames_file(i + 1, rng));
+	j["meta"]["version"] = 3;
+	return j.dump();
+}
+
+std::string make_idgames_dirs(std::size_t dirs, std::mt19937& rng) {
+	json j;
+	j["content"]["dir"] = json::array();
+	for (std::size_t i = 0; i < dirs; i++)
+		j["content"]["dir"].push_back({
+			{"id", i + 1},
+			{"name", "levels/doom2/" + random_name(rng, 6) + "/"}
+		});
+	j["meta"]["version"] = 3;
+	return j.dump();
+}
+
+std::string make_idgames_details(std::mt19937& rng) {
+	json j;
+	j["content"] = idgames_file(1 + rng() % 20000, rng);
+	j["meta"]["version"] = 3;
+	return j.dump();
+}
+
+void make_gzdoom_standin(const path& file, std::uint64_t gametics,
+		std::uint64_t realtics, double seconds) {
+	char result[128];
+	std::snprintf(result, sizeof(result), "%ju gametics in %ju realtics (%.1f fps)",
+			(std::uintmax_t)gametics, (std::uintmax_t)realtics,
+			realtics ? gametics * 35.0 / realtics : 0.0);
+	std::filesystem::create_directories(file.parent_path());
+	std::ofstream o(file);
+	o << "#!/bin/sh" << std::endl;
+	o << "sleep " << seconds << std::endl;
+	o << "echo \"Timedemo finished\"" << std::endl;
+	o << "echo \"" << result << "\"" << std::endl;
+	o.close();
+	std::filesystem::permissions(file, std::filesystem::perms::owner_all);
+}
@@ -0,0 +1,55 @@
+#ifndef GENERATE
+#define GENERATE
+
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// Synthetic data for the benchmark suite. Everything is derived from the
+// seed so runs on different machines see the same inputs.
+
+// A valid PWAD with `lumps` lumps of `lump_size` bytes, half of them
+// looking like a map so the lump analyzer has namespaces to work with.
+void make_wad(const path& file, std::size_t lumps, std::size_t lump_size,
+		std::mt19937& rng);
+
+// Fills rootdir/pwads with `files` WADs of roughly `file_size` bytes and
+// returns them sorted.
+std::vector<path> make_pool(const path& rootdir, std::size_t files,
+		std::size_t file_size, std::mt19937& rng);
+
+// Sorted paths shaped like make_pool's, without writing anything, for
+// cases that only need the names.
+std::vector<path> make_pool_names(const path& rootdir, std::size_t files, std::mt19937& rng);
+
+// A single IWAD in rootdir/iwads.
+path make_iwad(const path& rootdir, std::mt19937& rng);
+
+// `count` instances named bench-00000... each with `pwads` PWADs drawn from
+// the pool. Returns the instance directories.
+std::vector<path> make_instances(const path& rootdir, std::size_t count,
+		const path& iwad, const std::vector<path>& pool, std::size_t pwads,
+		std::mt19937& rng);
+
+// A zip of `files` entries of `file_size` bytes each, plus a text file the
+// installer is expected to skip. The data is about half compressible, like
+// real WAD contents.
+void make_zip(const path& archive, std::size_t files, std::size_t file_size,
+		std::mt19937& rng);
+
+// Responses shaped like the idGames API's getfiles/getdirs/get actions.
+std::string make_idgames_files(std::size_t files, std::mt19937& rng);
+std::string make_idgames_dirs(std::size_t dirs, std::mt19937& rng);
+std::string make_idgames_details(std::mt19937& rng);
+
+// A shell script standing in for GZDoom under -timedemo: it ignores its
+// arguments, sleeps `seconds` and prints the result line GZDoom ends a
+// timedemo with, e.g. "2134 gametics in 1530 realtics (48.8 fps)".
+void make_gzdoom_standin(const path& file, std::uint64_t gametics,
+		std::uint64_t realtics, double seconds);
+
+#endif
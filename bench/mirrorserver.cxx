@@ -0,0 +1,136 @@
+#include "mirrorserver.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <netinet/in.h>
+#include <poll.h>
+#include <regex>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MirrorServer::MirrorServer(const std::string& payload, MODE mode, int latency_ms) :
+		payload(payload), mode(mode), latency_ms(latency_ms) {
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t length = sizeof(address);
+	if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 ||
+			listen(listen_fd, 16) != 0 ||
+			getsockname(listen_fd, (sockaddr*)&address, &length) != 0) {
+		std::perror("mirror stand-in");
+		return;
+	}
+	port = ntohs(address.sin_port);
+	acceptor = std::thread(&MirrorServer::accept_loop, this);
+}
+
+MirrorServer::~MirrorServer() {
+	stopping = true;
+	if (acceptor.joinable()) acceptor.join();
+	for (std::thread& connection : connections) connection.join();
+	if (listen_fd >= 0) close(listen_fd);
+}
+
+std::string MirrorServer::url() const {
+	return "http://127.0.0.1:" + std::to_string(port) + "/idgames";
+}
+
+bool MirrorServer::pause(int ms) {
+	const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+	while (!stopping && std::chrono::steady_clock::now() < until)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	return !stopping;
+}
+
+void MirrorServer::accept_loop() {
+	while (!stopping) {
+		pollfd pfd = {.fd = listen_fd, .events = POLLIN};
+		if (poll(&pfd, 1, 50) <= 0) continue;
+		const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0) continue;
+		std::lock_guard<std::mutex> guard(lock);
+		connections.emplace_back(&MirrorServer::serve, this, fd);
+	}
+}
+
+// One request per connection, answered with Connection: close.
+void MirrorServer::serve(int fd) {
+	std::string request{};
+	char buffer[4096];
+	while (!stopping && request.find("\r\n\r\n") == std::string::npos) {
+		pollfd pfd = {.fd = fd, .events = POLLIN};
+		if (poll(&pfd, 1, 50) <= 0) continue;
+		const ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+		if (length <= 0) break;
+		request.append(buffer, length);
+	}
+	served++;
+
+	auto send_all = [&](const char* data, std::size_t size) {
+		while (size > 0 && !stopping) {
+			const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+			if (sent <= 0) return false;
+			data += sent;
+			size -= sent;
+		}
+		return size == 0;
+	};
+	auto respond = [&](const std::string& status, const std::string& headers,
+			std::size_t from, std::size_t to) {
+		const std::string head = "HTTP/1.1 " + status + "\r\n" + headers +
+			"Connection: close\r\n\r\n";
+		if (!send_all(head.data(), head.size())) return;
+		if (mode == MODE_CUT || mode == MODE_STALL) {
+			send_all(payload.data() + from, (to - from) / 3);
+			if (mode == MODE_STALL) while (pause(50)) {}
+			return;
+		}
+		if (mode != MODE_NO_END) {
+			send_all(payload.data() + from, to - from);
+			return;
+		}
+		// Chunked, with the length announced anyway, and the connection
+		// dropped where the terminating chunk should be: the client has
+		// every byte yet sees the transfer fail.
+		char size[32];
+		std::snprintf(size, sizeof(size), "%zx\r\n", to - from);
+		send_all(size, std::string(size).size());
+		send_all(payload.data() + from, to - from);
+		send_all("\r\n", 2);
+	};
+
+	if (latency_ms > 0 && !pause(latency_ms)) {
+		close(fd);
+		return;
+	}
+	static const std::regex range_header(R"(\r\nRange:\s*bytes=(\d+)-(\d*))",
+			std::regex::icase);
+	std::smatch range;
+	const std::string length = "Content-Length: ";
+	if (mode == MODE_FAIL) {
+		respond("503 Service Unavailable", length + "0\r\n", 0, 0);
+	} else if (mode != MODE_NO_RANGE && std::regex_search(request, range, range_header)) {
+		const std::size_t from = std::stoull(range[1]);
+		std::size_t to = range[2].length() ? std::stoull(range[2]) + 1 : payload.size();
+		to = std::min(to, payload.size());
+		if (from >= payload.size()) {
+			const std::string headers = "Content-Range: bytes */" +
+				std::to_string(payload.size()) + "\r\n" + length + "0\r\n";
+			const std::string head = "HTTP/1.1 416 Range Not Satisfiable\r\n" + headers +
+				"Connection: close\r\n\r\n";
+			send_all(head.data(), head.size());
+		} else {
+			respond("206 Partial Content", "Content-Range: bytes " + std::to_string(from) +
+				"-" + std::to_string(to - 1) + "/" + std::to_string(payload.size()) + "\r\n" +
+				length + std::to_string(to - from) + "\r\n" +
+				(mode == MODE_NO_END ? "Transfer-Encoding: chunked\r\n" : ""), from, to);
+		}
+	} else {
+		respond("200 OK", length + std::to_string(payload.size()) + "\r\n" +
+			(mode == MODE_NO_END ? "Transfer-Encoding: chunked\r\n" : ""), 0, payload.size());
+	}
+	shutdown(fd, SHUT_WR);
+	close(fd);
+}
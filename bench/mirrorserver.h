@@ -0,0 +1,54 @@
+#ifndef MIRRORSERVER
+#define MIRRORSERVER
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A local stand-in for an idGames mirror: a bare HTTP/1.1 server on
+// 127.0.0.1 that answers every GET with the same payload, honours Range
+// requests (416 past the end, like a real server) and can be told to
+// misbehave in the ways real mirrors do. Point MirrorSet at a few of them
+// through DOOM_INSTANCER_MIRRORS to exercise the race and the failover.
+class MirrorServer {
+	public:
+	enum MODE {
+		MODE_OK,
+		MODE_FAIL,     // 503 for everything
+		MODE_CUT,      // drops the connection a third of the way in
+		MODE_STALL,    // sends a third, then nothing until destroyed
+		MODE_NO_RANGE, // ignores Range and always sends the whole file
+		MODE_NO_END,   // sends every byte but never finishes the response
+	};
+
+	MirrorServer(const std::string& payload, MODE mode, int latency_ms = 0);
+	~MirrorServer();
+
+	MirrorServer(const MirrorServer&) = delete;
+	MirrorServer& operator=(const MirrorServer&) = delete;
+
+	// The base URL to list as a mirror.
+	[[nodiscard]] std::string url() const;
+	[[nodiscard]] int requests() const { return served.load(); }
+
+	private:
+	std::string payload;
+	MODE mode;
+	int latency_ms;
+	int listen_fd = -1;
+	int port = 0;
+	std::atomic<bool> stopping = false;
+	std::atomic<int> served = 0;
+	std::thread acceptor;
+	std::mutex lock;
+	std::vector<std::thread> connections;
+
+	void accept_loop();
+	void serve(int fd);
+	// Waits up to ms, returning early (false) once the server is stopping.
+	bool pause(int ms);
+};
+
+#endif
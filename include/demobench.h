@@ -0,0 +1,89 @@
+#ifndef DEMOBENCH
+#define DEMOBENCH
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "pool.h"
+
+typedef std::filesystem::path path;
+
+// Plays a demo back with -timedemo in one or more instances, several
+// GZDoom processes at a time, and records the result line GZDoom prints
+// when the demo ends. Results are kept in a JSON file so runs from
+// different sessions can be compared.
+//
+// Each run gets its own copy of the instance's GZDoom config and an empty
+// save directory under scratch_dir, so parallel runs of one instance never
+// write the same files and the instance itself is left as it was.
+class DemoBenchmark {
+	public:
+	struct run_t {
+		std::string instance;
+		std::string demo;
+		std::string extra_args;
+		std::string started;
+		int repeat;
+		bool finished;
+		bool ok;
+		int exit_code;
+		std::uint64_t gametics;
+		std::uint64_t realtics;
+		double fps;
+		double wall_seconds;
+		std::string log;
+	};
+
+	struct job_t {
+		path gzdoom_path;
+		std::vector<path> instances;
+		std::string demo;
+		std::string extra_args;
+		int repeats;
+		int parallel;
+		const PoolStack* pool; // resolves moved pool files, may be null
+	};
+
+	DemoBenchmark(const path& results_file, const path& log_dir, const path& scratch_dir);
+	~DemoBenchmark();
+
+	DemoBenchmark(const DemoBenchmark&) = delete;
+	DemoBenchmark& operator=(const DemoBenchmark&) = delete;
+
+	// Queues instances x repeats runs. Returns false if a benchmark is
+	// already in progress.
+	bool start(const job_t& job);
+	void cancel();
+	void clear();
+
+	[[nodiscard]] bool running() const { return active_slots > 0; }
+	[[nodiscard]] std::vector<run_t> results();
+
+	// Pulls the numbers out of a GZDoom log, e.g.
+	// "2134 gametics in 1530 realtics (48.8 fps)".
+	static bool parse_timedemo(const std::string& log, run_t& run);
+	static std::vector<std::string> split_args(const std::string& args);
+
+	private:
+	path results_file;
+	path log_dir;
+	path scratch_dir;
+
+	std::mutex lock;
+	std::vector<run_t> runs;
+	std::vector<pid_t> children;
+	std::vector<std::thread> slots;
+	std::atomic<int> active_slots = 0;
+	std::atomic<bool> cancelled = false;
+
+	void run_one(const job_t& job, std::size_t index);
+	void load_results();
+	void save_results();
+};
+
+#endif
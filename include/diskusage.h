@@ -0,0 +1,113 @@
+#ifndef DISKUSAGE
+#define DISKUSAGE
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// Tracks how many bytes each instance and each pool file occupy. The
+// first scan runs on a worker thread; afterwards the totals are kept up
+// to date from inotify events, so only changed files are re-stat'd.
+//
+// Per-instance and per-pool-file totals are adjusted as each file or
+// config.json changes. The worker publishes a copy of them once the first
+// scan is done and then at most every publish_interval, so readers never
+// wait on the scan or pay for every single change.
+class DiskUsage {
+	public:
+	struct instance_usage_t {
+		std::uintmax_t own_bytes;       // instances/<name>/**
+		std::uintmax_t exclusive_bytes; // pool files only this instance uses
+		std::uintmax_t shared_bytes;    // pool files other instances use too
+	};
+
+	struct usage_t {
+		bool ready;
+		std::uint64_t generation;
+		std::uintmax_t pwads_bytes;
+		std::uintmax_t iwads_bytes;
+		std::uintmax_t instances_bytes;
+		std::map<path, instance_usage_t> instances;
+		std::unordered_map<std::string, std::uintmax_t> pool_files;
+		std::unordered_map<std::string, std::size_t> pool_refs;
+	};
+
+	DiskUsage(const path& rootdir);
+	~DiskUsage();
+
+	DiskUsage(const DiskUsage&) = delete;
+	DiskUsage& operator=(const DiskUsage&) = delete;
+
+	void start();
+	void stop();
+
+	[[nodiscard]] bool ready() const { return scanned.load(); }
+	// Bumped whenever a new snapshot is published, so callers only copy it
+	// when something actually happened on disk.
+	[[nodiscard]] std::uint64_t generation() const { return published_generation.load(); }
+	[[nodiscard]] usage_t snapshot();
+
+	private:
+	enum AREA {
+		AREA_NONE,
+		AREA_INSTANCES,
+		AREA_PWADS,
+		AREA_IWADS,
+	};
+
+	path rootdir;
+	int inotify_fd = -1;
+	std::thread worker;
+	std::atomic<bool> running = false;
+	std::atomic<bool> scanned = false;
+	std::atomic<std::uint64_t> published_generation = 0;
+
+	// Only touched by the worker thread.
+	std::unordered_map<int, path> watches;
+
+	std::mutex lock;
+	// Every regular file under the watched areas and its last known size.
+	// Ordered so a removed directory can be dropped as one key range.
+	std::map<std::string, std::uintmax_t> files;
+	// instance dir -> pool files its config.json references.
+	std::map<path, std::vector<std::string>> references;
+	// pool file -> instances referencing it, whether or not it exists.
+	std::unordered_map<std::string, std::vector<path>> referrers;
+	// The running totals, in the shape they're published in.
+	std::map<path, instance_usage_t> instance_totals;
+	std::unordered_map<std::string, std::uintmax_t> pool_sizes;
+	std::uintmax_t area_bytes[4] = {0, 0, 0, 0};
+	std::uint64_t changes = 0;
+
+	std::mutex publish_lock;
+	usage_t published{.ready = false, .generation = 0};
+	std::uint64_t published_changes = 0;
+
+	void run();
+	void publish();
+	void full_scan();
+	void watch_tree(const path& dir);
+	void handle_event(int wd, std::uint32_t mask, const char* name);
+	void update_file(const path& file);
+	void remove_file(const path& file);
+	void remove_tree(const path& dir);
+	void read_references(const path& instance_dir);
+	void account(const std::string& file, std::uintmax_t before, std::uintmax_t after,
+			bool exists);
+	void charge_referrers(const std::string& ref, int sign);
+	void set_referrer(const std::string& ref, const path& instance, bool referenced);
+	[[nodiscard]] AREA area_of(const path& file) const;
+	[[nodiscard]] path instance_of(const path& file) const;
+};
+
+[[nodiscard]] std::string format_size(std::uintmax_t bytes);
+
+#endif
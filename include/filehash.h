@@ -0,0 +1,42 @@
+#ifndef FILEHASH
+#define FILEHASH
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+typedef std::filesystem::path path;
+
+// XXH64 of a whole file's contents, 0 if it can't be read.
+[[nodiscard]] std::uint64_t hash_file(const path& file);
+[[nodiscard]] std::string hash_string(std::uint64_t hash);
+
+// Remembers content hashes by path, size and mtime so unchanged files
+// never have to be read again. Safe to use from several threads.
+class HashCache {
+	public:
+	HashCache(const path& cache_file);
+	~HashCache();
+
+	HashCache(const HashCache&) = delete;
+	HashCache& operator=(const HashCache&) = delete;
+
+	[[nodiscard]] std::uint64_t hash(const path& file);
+	void save();
+
+	private:
+	struct entry_t {
+		std::uintmax_t size;
+		std::int64_t mtime;
+		std::uint64_t hash;
+	};
+
+	path cache_file;
+	std::mutex lock;
+	std::unordered_map<std::string, entry_t> entries;
+	bool dirty = false;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef FONTCACHE
+#define FONTCACHE
+
+#include <filesystem>
+#include "imgui.h"
+
+typedef std::filesystem::path path;
+
+// Adds the launcher's UI font: ProggyClean.ttf at 26px from the working
+// directory, or ImGui's built-in copy of the same font if it isn't there.
+ImFont* add_ui_font(ImFontAtlas* atlas);
+
+// Builds the font atlas, reusing the pixels and glyph tables baked by a
+// previous run when the font data, sizes, glyph ranges and build settings
+// all match. Call it after adding every font and before the first frame;
+// the renderer backend then uploads the atlas as usual. Returns true if
+// the atlas came from cache_file.
+//
+// ImGui 1.92 and later bake glyphs on demand, so there is nothing to
+// cache and this does nothing.
+bool build_font_atlas(ImFontAtlas* atlas, const path& cache_file);
+
+#endif
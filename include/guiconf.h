@@ -7,4 +7,9 @@
 #define MIN_WIN_SIZE_X (800)
 #define MIN_WIN_SIZE_Y (600)
 
+#define THUMBNAIL_SIZE (128)
+#define THUMBNAIL_DISPLAY_SIZE (96)
+
+#define SAVE_THUMBNAIL_HEIGHT (64)
+
 #endif
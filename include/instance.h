@@ -0,0 +1,25 @@
+#ifndef INSTANCE
+#define INSTANCE
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "pool.h"
+
+typedef std::filesystem::path path;
+
+// Reads an instance's config.json. IWAD/PWAD entries whose files no longer
+// exist are looked up by name in the pool, if given, so files moved between
+// pool layers still resolve; otherwise they are dropped. Returns false if
+// the config is missing or malformed.
+bool read_instance_config(const path& instance_dir, path& iwad_path,
+		std::vector<path>& pwad_paths, const PoolStack* pool = nullptr);
+
+// The GZDoom command line for an instance: its IWAD, PWADs, save directory
+// and config file, followed by any extra arguments.
+[[nodiscard]] std::vector<std::string> launch_arguments(const path& gzdoom_path,
+		const path& instance_dir, const path& iwad_path,
+		const std::vector<path>& pwad_paths,
+		const std::vector<std::string>& extra_args = {});
+
+#endif
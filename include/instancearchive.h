@@ -0,0 +1,57 @@
+#ifndef INSTANCEARCHIVE
+#define INSTANCEARCHIVE
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include "filehash.h"
+#include "pool.h"
+
+typedef std::filesystem::path path;
+
+// Moves an instance between machines as a single zip. The archive holds
+// the instance directory under instance/, a manifest.json naming every
+// pool file the instance references (with content hashes), and optionally
+// those pool files themselves under pool/iwads and pool/pwads.
+//
+// Export compresses 1 MiB blocks on all cores and streams them straight
+// into the output file in order, so nothing is staged in memory or on
+// disk beyond the blocks in flight.
+//
+// `hashes` may be null, in which case pool files are hashed from scratch.
+
+struct archive_progress_t {
+	std::atomic<std::uintmax_t> done_bytes = 0;
+	std::atomic<std::uintmax_t> total_bytes = 0;
+};
+
+struct export_result_t {
+	bool ok;
+	std::string error;
+	std::uintmax_t input_bytes;
+	std::uintmax_t output_bytes;
+	double seconds;
+};
+
+struct import_result_t {
+	bool ok;
+	std::string error;
+	std::string instance_name;
+	std::size_t pool_files_written;
+	std::size_t pool_files_skipped;
+	std::size_t pool_files_missing;
+};
+
+[[nodiscard]] export_result_t export_instance(const path& rootdir, const path& instance_dir,
+		const path& archive, bool include_pool, HashCache* hashes,
+		archive_progress_t* progress = nullptr, unsigned int threads = 0);
+
+// Pool files already visible through `pool` (in any layer) are reused;
+// new ones are always written to rootdir, the writable top layer, once
+// they match the manifest's hash and the instance itself is in place.
+[[nodiscard]] import_result_t import_instance(const path& rootdir, const path& archive,
+		HashCache* hashes, archive_progress_t* progress = nullptr,
+		const PoolStack* pool = nullptr);
+
+#endif
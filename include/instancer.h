@@ -0,0 +1,183 @@
+#ifndef INSTANCER
+#define INSTANCER
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+#include "diskusage.h"
+#include "lumpanalyzer.h"
+#include "filehash.h"
+#include "thumbnails.h"
+#include "savebrowser.h"
+#include "instancearchive.h"
+#include "pool.h"
+#include "loadorder.h"
+#include "selection.h"
+#include "demobench.h"
+#include "mirrors.h"
+#include <curl/curl.h>
+
+typedef std::filesystem::path path;
+
+class GZDoomInstancer {
+	public:
+	struct iga_details_t {
+		bool discovered;
+		std::string filename;
+		std::string name;
+		std::size_t id;
+		std::string description;
+		unsigned int rating;
+		unsigned int votes;
+	};
+
+	enum VIEW {
+		MANAGER_LAUNCHER_VIEW,
+		EDITOR_VIEW,
+		IDGAMES_VIEW,
+		BENCHMARK_VIEW,
+		METRICS_VIEW,
+	};
+
+	// ~/.doominstancer, where the default constructor keeps everything.
+	[[nodiscard]] static path default_rootdir();
+
+	GZDoomInstancer();
+	// A headless instancer never touches the network and doesn't run the
+	// background disk usage scan, which is what benchmarks and scripted use
+	// want.
+	GZDoomInstancer(const path& rootdir, bool headless = false);
+	~GZDoomInstancer();
+
+	[[nodiscard]] std::vector<std::string> darc_filters();
+	[[nodiscard]] const char* signature();
+
+	[[nodiscard]] const path iwad_dialog();
+	[[nodiscard]] const std::vector<path> pwad_dialog();
+	[[nodiscard]] const path gzdoom_dialog();
+	void add_pwad();
+	void add_iwad();
+
+	static std::size_t write_memory_cb(void* contents, std::size_t size, std::size_t nmemb,
+			void* userp);
+	const bool iga_ping();
+	const std::vector<path> iga_getdirs();
+	static const std::vector<path> iga_parse_dirs(const std::string& result);
+	const std::vector<path> iga_getfiles();
+	static const std::vector<path> iga_parse_files(const std::string& result);
+	iga_details_t iga_getdetails(path filename);
+	static iga_details_t iga_parse_details(const std::string& result);
+	void iga_downloadfile(path filename);
+	// Installs everything but the text files from a downloaded archive into
+	// the PWAD pool.
+	void iga_extract(const path& archive);
+
+	void launch_doom();
+
+	const std::vector<path> list_instances();
+	const std::vector<path> list_iwads();
+	const std::vector<path> list_available_pwads();
+	// Rereads the pool, which invalidates the row indices the selection
+	// refers to.
+	void refresh_available_pwads();
+	// Case-insensitive substring match on file names.
+	void filter_pwads();
+	// In pool order.
+	[[nodiscard]] std::vector<path> selected_pwads() const;
+	static const char* path_string_getter(void* data, int index);
+
+	void load_instance();
+	void save_instance();
+	void delete_instance();
+	void duplicate_instance();
+
+	void manager_launcher_view();
+	void editor_view();
+	void archive_view();
+	void save_browser_view();
+	void map_thumbnails_view(const path& file);
+	void lump_overrides_view();
+	void mirrors_section();
+	void idgames_view();
+	void benchmark_view();
+	void metrics_view();
+
+	void process();
+
+
+	private:
+	// The benchmark suite (bench/bench.cxx) drives the views through this
+	// to pick a view, an instance and a save name without any input.
+	friend class InstancerBench;
+
+	path rootdir;
+	path iwad_path;
+	LoadOrder pwad_paths;
+	std::vector<path> available_pwad_paths;
+	std::vector<std::size_t> visible_pwads;
+	Selection pwad_selection;
+	char pwad_filter[64] = "";
+	std::vector<path> available_instance_paths;
+	std::vector<path> available_iwad_paths;
+	std::vector<path> available_idgames_paths;
+	path gzdoom_path;
+	PoolStack* pool;
+	MirrorSet* mirrors;
+	DiskUsage* disk_usage;
+	DiskUsage::usage_t usage = {.ready = false, .generation = 0};
+	LumpAnalyzer lump_analyzer;
+	HashCache* file_hashes;
+	ThumbnailCache* thumbnails;
+	SaveBrowser save_browser;
+
+	bool export_include_pool = true;
+	std::future<std::string> archive_job;
+	std::string archive_job_name;
+	std::string archive_status;
+	archive_progress_t archive_progress;
+
+	DemoBenchmark* demo_benchmark;
+	std::vector<bool> benchmark_instances;
+	char benchmark_demo[64] = "demo1";
+	char benchmark_args[256] = "-nosound";
+	int benchmark_repeats = 1;
+	int benchmark_parallel = 1;
+
+	std::string metrics_status;
+	std::vector<path> analyzed_load_order;
+	std::uint64_t analyzed_generation = 0;
+	path analyzed_iwad;
+	std::string api_url;
+	std::string api_filename;
+
+	char new_instance_name[32];
+
+	int last_instance_index = -1;
+	int current_instance_index = 0;
+	int current_iwad_index = 0;
+
+	bool close_on_launch = false;
+
+	bool pinged_api_recently = false;
+	bool api_ping_result = false;
+
+	bool obtained_files = false;
+	int current_idgames_index = 0;
+	int previous_idgames_index = -1;
+	path current_idgames_path;
+	iga_details_t current_idgames_details;
+
+	VIEW current_view = MANAGER_LAUNCHER_VIEW;
+
+	struct memory_chunk {
+		char* data;
+		std::size_t size;
+	};
+
+	CURLcode iga_perform(CURL* curl);
+	void iga_prepare_curl(const char* url, CURL* curl, memory_chunk** chunk);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LOADORDER
+#define LOADORDER
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// An instance's active PWADs in load order, kept as a linked list plus a
+// hash index into it. Activating or deactivating k files costs O(k)
+// whatever the length of the list, and never reorders the files that
+// stay.
+class LoadOrder {
+	public:
+	void assign(const std::vector<path>& paths);
+	void clear();
+
+	[[nodiscard]] bool contains(const path& pwad) const { return index.contains(pwad.string()); }
+	[[nodiscard]] std::size_t size() const { return order.size(); }
+	[[nodiscard]] bool empty() const { return order.empty(); }
+	[[nodiscard]] std::list<path>::const_iterator begin() const { return order.begin(); }
+	[[nodiscard]] std::list<path>::const_iterator end() const { return order.end(); }
+	[[nodiscard]] std::vector<path> paths() const { return {order.begin(), order.end()}; }
+	// Bumped on every change, so callers can tell when to redo work that
+	// depends on the load order.
+	[[nodiscard]] std::uint64_t generation() const { return changes; }
+
+	// Appends whichever files aren't active yet, in the order given.
+	// Returns how many were added.
+	std::size_t activate(const std::vector<path>& pwads);
+	// Returns how many were removed.
+	std::size_t deactivate(const std::vector<path>& pwads);
+
+	private:
+	std::list<path> order{};
+	std::unordered_map<std::string, std::list<path>::iterator> index{};
+	std::uint64_t changes = 0;
+};
+
+#endif
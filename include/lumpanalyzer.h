@@ -0,0 +1,71 @@
+#ifndef LUMPANALYZER
+#define LUMPANALYZER
+
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// Works out which lumps (or PK3 resources) each file of a load order
+// replaces from the files loaded before it. Directories are parsed in
+// parallel off the render thread and cached per file, so changing the
+// load order only reparses files that were not seen before.
+class LumpAnalyzer {
+	public:
+	struct override_t {
+		std::string key;
+		std::size_t overridden; // index into result_t::files
+	};
+
+	struct file_t {
+		path file;
+		bool readable;
+		std::size_t lumps;
+		std::vector<override_t> overrides;
+	};
+
+	struct result_t {
+		std::vector<path> load_order;
+		std::vector<file_t> files;
+		std::size_t total_lumps;
+		std::size_t conflicts;
+		double seconds;
+	};
+
+	~LumpAnalyzer();
+
+	// Queues an analysis of the given load order; a request made while one
+	// is already running replaces any older queued request.
+	void analyze(const std::vector<path>& load_order);
+	// Called once per frame. Returns true when a new result became
+	// available.
+	bool poll();
+
+	[[nodiscard]] bool busy() const { return job.valid(); }
+	[[nodiscard]] const result_t& result() const { return last_result; }
+
+	private:
+	struct directory_t {
+		std::filesystem::file_time_type mtime;
+		std::uintmax_t size;
+		bool readable;
+		std::vector<std::string> keys;
+	};
+
+	std::mutex cache_lock;
+	std::unordered_map<std::string, directory_t> cache;
+
+	std::future<result_t> job;
+	std::vector<path> pending;
+	bool has_pending = false;
+	result_t last_result = {};
+
+	result_t run(std::vector<path> load_order);
+	[[nodiscard]] directory_t read_directory(const path& file);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef MIRRORS
+#define MIRRORS
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// The idGames file mirrors. A background thread periodically fetches the
+// first few hundred KiB of a probe file from every mirror to estimate
+// time to first byte and throughput. Downloads go to the mirror expected
+// to finish first.
+//
+// A download can race the top two mirrors: the first to send a byte
+// wins and the other is dropped. If the winner fails or stalls partway,
+// the next mirror continues from the bytes already written using an HTTP
+// Range request.
+//
+// Mirrors come from the "mirrors" array in mirrors.json, or from
+// DOOM_INSTANCER_MIRRORS (whitespace or comma separated), which is the
+// easy way to point the launcher at local stand-in servers.
+class MirrorSet {
+	public:
+	struct mirror_t {
+		std::string url;
+		double latency_ms;     // time to first byte, 0 if never measured
+		double throughput_bps; // 0 if never measured
+		int failures;          // consecutive
+		std::time_t last_probe;
+		std::time_t retry_after;
+	};
+
+	struct progress_t {
+		std::atomic<std::uintmax_t> done_bytes = 0;
+		std::atomic<std::uintmax_t> total_bytes = 0;
+	};
+
+	struct result_t {
+		bool ok;
+		std::string error;
+		std::string mirror;
+		std::uintmax_t bytes;
+		int failovers;
+		double seconds;
+	};
+
+	MirrorSet(const path& config_file);
+	~MirrorSet();
+
+	MirrorSet(const MirrorSet&) = delete;
+	MirrorSet& operator=(const MirrorSet&) = delete;
+
+	void start();
+	// Also aborts a probe that is in progress.
+	void stop();
+
+	// One synchronous probe of every mirror, all in parallel.
+	void probe();
+	void probe_soon();
+
+	// Fetches <mirror>/<relative> into output.
+	result_t download(const std::string& relative, const path& output,
+			progress_t* progress = nullptr);
+
+	// Best first. Mirrors that recently failed sort last.
+	[[nodiscard]] std::vector<mirror_t> ranked() const;
+	[[nodiscard]] bool racing() const { return race; }
+
+	private:
+	struct transfer_t;
+	struct download_t;
+
+	std::vector<mirror_t> mirrors;
+	bool race = true;
+	std::string probe_path = "ls-laR.gz";
+	long probe_bytes = 256 << 10;
+	int probe_interval = 900;
+	int stall_timeout = 10;
+	int connect_timeout = 10;
+
+	mutable std::mutex lock;
+	std::condition_variable wake;
+	std::thread prober;
+	bool running = false;
+	bool probe_requested = false;
+	// Set by stop() so a probe in flight gives up at once instead of
+	// running into its timeout; probing is the multi handle to wake.
+	std::atomic<bool> stopping = false;
+	void* probing = nullptr;
+
+	[[nodiscard]] std::vector<std::size_t> ranking() const;
+	void record_success(std::size_t mirror, double latency_ms, double throughput_bps);
+	void record_failure(std::size_t mirror);
+	void run();
+};
+
+#endif
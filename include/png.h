@@ -0,0 +1,13 @@
+#ifndef PNGDECODE
+#define PNGDECODE
+
+#include <cstdint>
+#include <vector>
+
+// Minimal PNG decoder for the screenshots GZDoom embeds in its saves:
+// 8-bit greyscale, RGB, paletted and RGBA images without interlacing.
+// Pixels come out as RGBA8 in memory order.
+[[nodiscard]] bool decode_png(const unsigned char* data, std::size_t size,
+		std::vector<std::uint32_t>& pixels, int& width, int& height);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef POOL
+#define POOL
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// The IWAD/PWAD pool as a stack of roots, each with its own pwads/ and
+// iwads/ directories. rootdir is always the top, writable layer; below it
+// come read-only roots (e.g. a system-wide pool under /srv) taken from
+// rootdir/pools.json and DOOM_INSTANCER_POOLS (colon separated), earlier
+// entries shadowing later ones just like PATH.
+//
+// A merged index maps each file name to the highest layer that has it.
+// refresh() only rescans layers whose directory changed since the last
+// look (or changed so recently its mtime can't be trusted yet) and patches
+// the index with the names that came and went.
+class PoolStack {
+	public:
+	enum KIND {
+		PWADS,
+		IWADS,
+	};
+
+	struct layer_t {
+		path root;
+		bool writable;
+	};
+
+	PoolStack(const path& rootdir);
+
+	PoolStack(const PoolStack&) = delete;
+	PoolStack& operator=(const PoolStack&) = delete;
+
+	// Returns true if anything changed.
+	bool refresh();
+	// Forgets everything so the next refresh() rescans every layer.
+	void invalidate();
+
+	// The visible file with this name, or an empty path.
+	[[nodiscard]] path resolve(KIND kind, const std::string& name) const;
+	// Every visible file, sorted by name.
+	[[nodiscard]] std::vector<path> list(KIND kind) const;
+	// Index into layers() of the layer a file lives in, or -1.
+	[[nodiscard]] int layer_of(const path& file) const;
+	[[nodiscard]] bool writable(const path& file) const { return layer_of(file) == 0; }
+	[[nodiscard]] std::vector<layer_t> layers() const;
+
+	private:
+	struct directory_t {
+		path dir;
+		bool scanned = false;
+		std::filesystem::file_time_type mtime{};
+		std::filesystem::file_time_type scanned_at{};
+		std::unordered_set<std::string> names{};
+	};
+
+	struct layer_state_t {
+		layer_t layer;
+		directory_t directories[2];
+	};
+
+	mutable std::mutex lock;
+	std::vector<layer_state_t> stack;
+	// name -> index of the highest layer providing it.
+	std::unordered_map<std::string, std::size_t> index[2];
+	std::vector<path> sorted[2];
+
+	bool refresh_directory(KIND kind, std::size_t layer);
+	void rebuild_sorted(KIND kind);
+};
+
+#endif
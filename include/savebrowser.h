@@ -0,0 +1,102 @@
+#ifndef SAVEBROWSER
+#define SAVEBROWSER
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// Lists the .zds saves of one instance along with their title, map, date
+// and screenshot. What has been read once is kept in saveindex.json and
+// saveindex.bin inside the instance, so only new or rewritten saves are
+// ever reopened. Decoding happens on a worker thread; rows the UI is
+// currently drawing jump to the front of its queue.
+class SaveBrowser {
+	public:
+	struct row_t {
+		std::string name;
+		std::string title;
+		std::string map;
+		std::string time;
+		bool indexed;
+		unsigned int texture;
+		int thumb_width;
+		int thumb_height;
+	};
+
+	SaveBrowser();
+	~SaveBrowser();
+
+	SaveBrowser(const SaveBrowser&) = delete;
+	SaveBrowser& operator=(const SaveBrowser&) = delete;
+
+	void open(const path& instance_dir);
+	void close();
+	// Picks up saves written, rewritten or deleted since open(), e.g. by a
+	// game launched from here, keeping everything already indexed. Call it
+	// every frame; it re-stats save/ at most once a second.
+	void refresh();
+	[[nodiscard]] const path& instance() const { return instance_dir; }
+	[[nodiscard]] std::size_t size();
+
+	// Copies row i for display and bumps it to the front of the decode
+	// queue if it still needs work. Uploads a decoded thumbnail to GL, so
+	// this must only be called from the render thread.
+	[[nodiscard]] row_t row(std::size_t i);
+	// Frees thumbnail textures of rows that were not drawn this frame once
+	// too many are resident.
+	void end_frame();
+
+	private:
+	struct save_t {
+		path file;
+		std::uintmax_t size;
+		std::int64_t mtime;
+		bool indexed;
+		bool queued;
+		std::string title;
+		std::string map;
+		std::string time;
+		std::uint64_t thumb_offset;
+		int thumb_width;
+		int thumb_height;
+		std::vector<std::uint32_t> pixels;
+		unsigned int texture;
+		std::uint64_t last_drawn;
+	};
+
+	path instance_dir;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread worker;
+	bool stopping = false;
+	bool index_dirty = false;
+	std::vector<save_t> saves;
+	std::deque<std::size_t> queue;
+	// Rows nobody has looked at yet still get indexed, just after the
+	// visible ones.
+	std::size_t backlog = 0;
+	// Bumped whenever refresh() reorders saves, so the worker can drop a
+	// result whose row index went stale.
+	std::uint64_t generation = 0;
+	std::chrono::steady_clock::time_point refreshed_at{};
+	std::uint64_t frame = 0;
+	std::size_t resident_textures = 0;
+
+	[[nodiscard]] std::vector<save_t> scan() const;
+	void run();
+	void load_index();
+	void save_index();
+	[[nodiscard]] bool read_save(save_t& save, std::vector<std::uint32_t>& pixels);
+	[[nodiscard]] bool read_thumbnail(const save_t& save, std::vector<std::uint32_t>& pixels);
+	[[nodiscard]] bool append_thumbnail(const std::vector<std::uint32_t>& pixels, std::uint64_t& offset);
+};
+
+#endif
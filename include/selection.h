@@ -0,0 +1,50 @@
+#ifndef SELECTION
+#define SELECTION
+
+#include <cstddef>
+#include <vector>
+
+// A set of selected rows out of a list of count items, as a sparse set:
+// membership, insertion and removal are O(1), clear() is O(1) and the
+// selected items can be walked in O(k) without touching the rest of the
+// list.
+//
+// Bulk operations take the rows currently shown (e.g. the ones matching
+// a filter) as indices into the full list, so shift-click ranges and
+// select-all follow what the user sees.
+class Selection {
+	public:
+	// Starts over with count items and nothing selected.
+	void reset(std::size_t count);
+	void clear();
+
+	[[nodiscard]] bool contains(std::size_t item) const {
+		return item < sparse.size() && sparse[item] < dense.size() &&
+			dense[sparse[item]] == item;
+	}
+	[[nodiscard]] std::size_t size() const { return dense.size(); }
+	[[nodiscard]] bool empty() const { return dense.empty(); }
+	[[nodiscard]] std::size_t count() const { return sparse.size(); }
+	// In the order they were selected.
+	[[nodiscard]] const std::vector<std::size_t>& items() const { return dense; }
+	// In list order.
+	[[nodiscard]] std::vector<std::size_t> sorted() const;
+
+	void set(std::size_t item, bool selected);
+	void toggle(std::size_t item) { set(item, !contains(item)); }
+
+	// A click on visible[row]: plain clicks select just that row, ctrl
+	// toggles it and shift selects everything from the last clicked row.
+	void click(const std::vector<std::size_t>& visible, std::size_t row, bool ctrl, bool shift);
+	void select_all(const std::vector<std::size_t>& visible);
+	// Deselects everything not in visible, which must be in list order.
+	void retain(const std::vector<std::size_t>& visible);
+
+	private:
+	std::vector<std::size_t> dense{};
+	std::vector<std::size_t> sparse{};
+	std::size_t anchor = 0;
+	bool has_anchor = false;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef THUMBNAILS
+#define THUMBNAILS
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "filehash.h"
+
+typedef std::filesystem::path path;
+
+// Automap-style previews of every map in a WAD/PK3. Maps are decoded and
+// rasterised on the CPU by a pool of worker threads, stored on disk as one
+// atlas per file (keyed by content hash) and only turned into a GL texture
+// once something actually draws them.
+class ThumbnailCache {
+	public:
+	struct atlas_t {
+		std::vector<std::string> maps;
+		// THUMBNAIL_SIZE^2 luminance bytes per map, in map order.
+		std::vector<unsigned char> pixels;
+		unsigned int texture = 0;
+		int columns = 1;
+		int rows = 1;
+	};
+
+	ThumbnailCache(const path& cache_dir, HashCache* hashes);
+	~ThumbnailCache();
+
+	ThumbnailCache(const ThumbnailCache&) = delete;
+	ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+	// The finished atlas for a file, or nullptr while it is still being
+	// generated (the first call queues it).
+	atlas_t* request(const path& file);
+	// Creates the atlas texture on first use. Render thread only.
+	unsigned int texture(atlas_t* atlas);
+
+	private:
+	struct job_t;
+
+	path cache_dir;
+	HashCache* hashes;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+	// nullptr while queued or rendering.
+	std::unordered_map<std::string, std::shared_ptr<atlas_t>> atlases;
+
+	void worker();
+	void push(std::function<void()> task);
+	void generate(const path& file);
+	void publish(const path& file, std::shared_ptr<atlas_t> atlas);
+	[[nodiscard]] bool load_atlas(const path& atlas_file, atlas_t& atlas);
+	void save_atlas(const path& atlas_file, const atlas_t& atlas);
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef TRACE
+#define TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// Scoped timing spans and a handful of counters. Spans cost one relaxed
+// atomic load while tracing is off; when it is on they are kept in a
+// bounded buffer that can be exported as Chrome trace JSON
+// (chrome://tracing, Perfetto) and summarised per operation.
+namespace trace {
+	enum counter_t {
+		BYTES_DOWNLOADED,
+		CACHE_HITS,
+		CACHE_MISSES,
+		ALLOCATIONS,
+		ALLOCATED_BYTES,
+		COUNTER_COUNT
+	};
+
+	struct operation_t {
+		std::string name;
+		std::uint64_t count;
+		double total_ms;
+		double p50_ms;
+		double p99_ms;
+		double max_ms;
+	};
+
+	extern std::atomic<bool> enabled;
+	extern std::atomic<std::uint64_t> counters[COUNTER_COUNT];
+
+	void set_enabled(bool enable);
+	void clear();
+
+	[[nodiscard]] const char* counter_name(counter_t counter);
+	[[nodiscard]] std::vector<operation_t> operations();
+	[[nodiscard]] std::size_t event_count();
+	bool export_chrome(const path& file);
+
+	inline void count(counter_t counter, std::uint64_t amount = 1) {
+		if (enabled.load(std::memory_order_relaxed))
+			counters[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	// Monotonic nanoseconds since the trace epoch.
+	[[nodiscard]] std::uint64_t now();
+	void record(const char* name, std::uint64_t start, std::uint64_t end);
+
+	class Scope {
+		public:
+		// name must outlive the trace, in practice a string literal.
+		explicit Scope(const char* name) : name(name),
+			start(enabled.load(std::memory_order_relaxed) ? now() : 0) {}
+		~Scope() { if (start) record(name, start, now()); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		private:
+		const char* name;
+		std::uint64_t start;
+	};
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef DOOM_INSTANCER_NO_TRACE
+#define TRACE_SCOPE(name) ((void)0)
+#else
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef WAD
+#define WAD
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+typedef std::filesystem::path path;
+
+// Read-only mmap of a whole file. Empty (valid() == false) if the file
+// could not be opened or mapped.
+class MappedFile {
+	public:
+	MappedFile(const path& file);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	[[nodiscard]] bool valid() const { return data_ptr != nullptr; }
+	[[nodiscard]] const unsigned char* data() const { return data_ptr; }
+	[[nodiscard]] std::size_t size() const { return data_size; }
+
+	private:
+	const unsigned char* data_ptr = nullptr;
+	std::size_t data_size = 0;
+};
+
+struct lump_t {
+	std::string name;
+	std::uint32_t offset;
+	std::uint32_t size;
+};
+
+// Parses the lump directory of an in-memory IWAD/PWAD. Returns false if
+// the header or directory is malformed.
+[[nodiscard]] bool read_wad_directory(const unsigned char* data, std::size_t size,
+		std::vector<lump_t>& lumps);
+
+// Lists every file entry of a PK3/ZIP held in memory.
+[[nodiscard]] bool read_pk3_directory(const unsigned char* data, std::size_t size,
+		std::vector<std::string>& entries);
+
+[[nodiscard]] bool is_wad(const unsigned char* data, std::size_t size);
+
+// True for the lumps that make up a map's data after its header lump.
+[[nodiscard]] bool is_map_lump(const std::string& name);
+
+#endif
@@ -0,0 +1,285 @@
+#include "demobench.h"
+#include "instance.h"
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <regex>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+using json=nlohmann::json;
+
+static constexpr double ticrate = 35.0;
+
+DemoBenchmark::DemoBenchmark(const path& results_file, const path& log_dir,
+		const path& scratch_dir) :
+		results_file(results_file), log_dir(log_dir), scratch_dir(scratch_dir) {
+	load_results();
+}
+
+DemoBenchmark::~DemoBenchmark() {
+	cancel();
+	for (std::thread& thread : slots) thread.join();
+}
+
+bool DemoBenchmark::start(const job_t& job) {
+	if (running()) return false;
+	for (std::thread& thread : slots) thread.join();
+	slots.clear();
+	cancelled = false;
+
+	char timestr[64];
+	std::time_t now = std::time(nullptr);
+	std::strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+
+	std::size_t first, end;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		first = runs.size();
+		for (int repeat = 1; repeat <= job.repeats; repeat++) {
+			for (const path& instance : job.instances) {
+				runs.push_back({
+					.instance = instance.string(),
+					.demo = job.demo,
+					.extra_args = job.extra_args,
+					.started = timestr,
+					.repeat = repeat,
+					.finished = false,
+					.ok = false,
+					.exit_code = 0,
+					.gametics = 0,
+					.realtics = 0,
+					.fps = 0,
+					.wall_seconds = 0
+				});
+			}
+		}
+		end = runs.size();
+	}
+	if (first == end) return false;
+
+	// Every slot keeps pulling the next queued run until none are left.
+	auto next = std::make_shared<std::atomic<std::size_t>>(first);
+	const int slot_count = std::max(1, std::min<int>(job.parallel, end - first));
+	active_slots = slot_count;
+	for (int i = 0; i < slot_count; i++) {
+		slots.emplace_back([this, job, next, end]() {
+			for (std::size_t index = (*next)++; index < end && !cancelled; index = (*next)++)
+				run_one(job, index);
+			active_slots--;
+		});
+	}
+	return true;
+}
+
+void DemoBenchmark::cancel() {
+	cancelled = true;
+	std::lock_guard<std::mutex> guard(lock);
+	for (pid_t child : children) {
+		kill(-child, SIGTERM);
+		kill(child, SIGTERM);
+	}
+}
+
+void DemoBenchmark::clear() {
+	if (running()) return;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		runs.clear();
+	}
+	save_results();
+}
+
+std::vector<DemoBenchmark::run_t> DemoBenchmark::results() {
+	std::lock_guard<std::mutex> guard(lock);
+	return runs;
+}
+
+void DemoBenchmark::run_one(const job_t& job, std::size_t index) {
+	path instance_dir;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		instance_dir = runs[index].instance;
+	}
+
+	path iwad_path;
+	std::vector<path> pwad_paths{};
+	read_instance_config(instance_dir, iwad_path, pwad_paths, job.pool);
+
+	// GZDoom rewrites its config on exit and may autosave, so every run
+	// plays in a throwaway copy of the instance's state.
+	std::error_code ec;
+	const path scratch = scratch_dir / ("run-" + std::to_string(index));
+	std::filesystem::remove_all(scratch, ec);
+	std::filesystem::create_directories(scratch / "save", ec);
+	if (std::filesystem::exists(instance_dir / "config", ec))
+		std::filesystem::copy_file(instance_dir / "config", scratch / "config", ec);
+
+	std::vector<std::string> extra_args{"-timedemo", job.demo};
+	for (const std::string& arg : split_args(job.extra_args)) extra_args.push_back(arg);
+	const std::vector<std::string> args = launch_arguments(job.gzdoom_path, scratch,
+			iwad_path, pwad_paths, extra_args);
+	std::vector<const char*> argv{};
+	for (const std::string& arg : args) argv.push_back(arg.c_str());
+	argv.push_back(nullptr);
+
+	std::filesystem::create_directories(log_dir, ec);
+	const path log = log_dir / ("bench-" + instance_dir.filename().string() + "-" +
+		std::to_string(std::time(nullptr)) + "-" + std::to_string(index) + ".log");
+
+	// Forked and registered under the lock, so cancel() either sees the
+	// child or has already set cancelled before we get here.
+	auto start = std::chrono::steady_clock::now();
+	pid_t pid;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (cancelled) {
+			std::filesystem::remove_all(scratch, ec);
+			return;
+		}
+		pid = fork();
+		if (pid > 0) {
+			setpgid(pid, pid);
+			children.push_back(pid);
+		}
+	}
+	if (pid == 0) {
+		// Own process group, so cancelling also takes down anything GZDoom
+		// spawned itself.
+		setpgid(0, 0);
+		int fd = open(log.c_str(), O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
+		if (fd >= 0) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+		}
+		execv(argv[0], const_cast<char* const*>(argv.data()));
+		_exit(127);
+	}
+
+	int status = 0;
+	if (pid > 0) {
+		waitpid(pid, &status, 0);
+		std::lock_guard<std::mutex> guard(lock);
+		std::erase(children, pid);
+	}
+	const double wall_seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+	std::filesystem::remove_all(scratch, ec);
+
+	std::ifstream i(log);
+	std::stringstream contents;
+	contents << i.rdbuf();
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		run_t& run = runs[index];
+		run.finished = true;
+		run.exit_code = pid < 0 ? -1 :
+			WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+		run.wall_seconds = wall_seconds;
+		run.log = log.string();
+		run.ok = parse_timedemo(contents.str(), run);
+	}
+	save_results();
+}
+
+bool DemoBenchmark::parse_timedemo(const std::string& log, run_t& run) {
+	static const std::regex result_line(
+			R"((\d+)\s+gametics\s+in\s+(\d+)\s+realtics(?:\s*\(\s*([0-9.]+)\s*fps\s*\))?)");
+	std::smatch match;
+	bool found = false;
+	// The last result in the log wins, in case the demo was looped.
+	for (auto it = std::sregex_iterator(log.begin(), log.end(), result_line);
+			it != std::sregex_iterator(); it++) {
+		match = *it;
+		found = true;
+	}
+	if (!found) return false;
+
+	run.gametics = std::stoull(match[1]);
+	run.realtics = std::stoull(match[2]);
+	if (match[3].matched) run.fps = std::stod(match[3]);
+	else run.fps = run.realtics ? run.gametics * ticrate / run.realtics : 0;
+	return true;
+}
+
+std::vector<std::string> DemoBenchmark::split_args(const std::string& args) {
+	std::vector<std::string> split{};
+	std::string current{};
+	bool quoted = false, has_arg = false;
+	for (char c : args) {
+		if (c == '"') {
+			quoted = !quoted;
+			has_arg = true;
+		} else if (isspace((unsigned char)c) && !quoted) {
+			if (has_arg) split.push_back(current);
+			current.clear();
+			has_arg = false;
+		} else {
+			current += c;
+			has_arg = true;
+		}
+	}
+	if (has_arg) split.push_back(current);
+	return split;
+}
+
+void DemoBenchmark::load_results() {
+	std::ifstream i(results_file);
+	if (!i.is_open()) return;
+	json j = json::parse(i, nullptr, false);
+	if (!j.is_array()) return;
+	for (const json& entry : j) {
+		if (!entry.is_object()) continue;
+		runs.push_back({
+			.instance = entry.value("instance", ""),
+			.demo = entry.value("demo", ""),
+			.extra_args = entry.value("extra_args", ""),
+			.started = entry.value("started", ""),
+			.repeat = entry.value("repeat", 1),
+			.finished = true,
+			.ok = entry.value("ok", false),
+			.exit_code = entry.value("exit_code", 0),
+			.gametics = entry.value("gametics", (std::uint64_t)0),
+			.realtics = entry.value("realtics", (std::uint64_t)0),
+			.fps = entry.value("fps", 0.0),
+			.wall_seconds = entry.value("wall_seconds", 0.0),
+			.log = entry.value("log", "")
+		});
+	}
+}
+
+void DemoBenchmark::save_results() {
+	json j = json::array();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (const run_t& run : runs) {
+			if (!run.finished) continue;
+			j.push_back({
+				{"instance", run.instance},
+				{"demo", run.demo},
+				{"extra_args", run.extra_args},
+				{"started", run.started},
+				{"repeat", run.repeat},
+				{"ok", run.ok},
+				{"exit_code", run.exit_code},
+				{"gametics", run.gametics},
+				{"realtics", run.realtics},
+				{"fps", run.fps},
+				{"wall_seconds", run.wall_seconds},
+				{"log", run.log}
+			});
+		}
+	}
+	// Several slots can finish at once; the file itself is written under a
+	// separate lock so the results table never waits on disk.
+	static std::mutex file_lock;
+	std::lock_guard<std::mutex> guard(file_lock);
+	std::ofstream o(results_file);
+	if (!o.is_open()) return;
+	o << j.dump(1, '\t') << std::endl;
+}
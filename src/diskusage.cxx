@@ -0,0 +1,325 @@
+#include "diskusage.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+using json=nlohmann::json;
+
+static constexpr std::chrono::milliseconds publish_interval(250);
+
+static constexpr std::uint32_t watch_mask =
+	IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+	IN_DELETE_SELF | IN_ONLYDIR;
+
+DiskUsage::DiskUsage(const path& rootdir) : rootdir(rootdir) {}
+
+DiskUsage::~DiskUsage() {
+	stop();
+}
+
+void DiskUsage::start() {
+	if (running) return;
+	running = true;
+	worker = std::thread(&DiskUsage::run, this);
+}
+
+void DiskUsage::stop() {
+	running = false;
+	if (worker.joinable()) worker.join();
+}
+
+DiskUsage::usage_t DiskUsage::snapshot() {
+	std::lock_guard<std::mutex> guard(publish_lock);
+	return published;
+}
+
+// Worker thread only. Copies the running totals, which costs O(pool files +
+// instances) rather than O(everything on disk).
+void DiskUsage::publish() {
+	TRACE_SCOPE("fs.disk_usage_publish");
+	usage_t usage{};
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (changes == published_changes && published.ready == scanned) return;
+		usage = {
+			.ready = scanned,
+			.generation = published_generation + 1,
+			.pwads_bytes = area_bytes[AREA_PWADS],
+			.iwads_bytes = area_bytes[AREA_IWADS],
+			.instances_bytes = area_bytes[AREA_INSTANCES],
+			.instances = instance_totals,
+			.pool_files = pool_sizes,
+		};
+		for (const auto& [ref, instances] : referrers)
+			if (pool_sizes.contains(ref)) usage.pool_refs[ref] = instances.size();
+		published_changes = changes;
+	}
+	std::lock_guard<std::mutex> guard(publish_lock);
+	published = std::move(usage);
+	published_generation = published.generation;
+}
+
+void DiskUsage::run() {
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	full_scan();
+	if (running) {
+		scanned = true;
+		publish();
+	}
+	auto last_publish = std::chrono::steady_clock::now();
+
+	alignas(inotify_event) char buffer[16384];
+	while (running) {
+		if (inotify_fd < 0) break;
+		pollfd pfd = {.fd = inotify_fd, .events = POLLIN};
+		if (poll(&pfd, 1, 250) > 0) {
+			ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+			for (char* ptr = buffer; length > 0 && ptr < buffer + length;) {
+				const inotify_event* event = (const inotify_event*)ptr;
+				if (event->mask & IN_Q_OVERFLOW) {
+					full_scan();
+					break;
+				}
+				handle_event(event->wd, event->mask, event->len ? event->name : "");
+				ptr += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now - last_publish < publish_interval) continue;
+		publish();
+		last_publish = now;
+	}
+
+	if (inotify_fd >= 0) close(inotify_fd);
+	inotify_fd = -1;
+	watches.clear();
+}
+
+// Gives up as soon as stop() is called, leaving the totals incomplete; a
+// big pool would otherwise hold up whoever is joining the worker.
+void DiskUsage::full_scan() {
+	TRACE_SCOPE("fs.disk_usage_scan");
+	for (const auto& [wd, dir] : watches)
+		inotify_rm_watch(inotify_fd, wd);
+	watches.clear();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		files.clear();
+		references.clear();
+		referrers.clear();
+		instance_totals.clear();
+		pool_sizes.clear();
+		for (std::uintmax_t& bytes : area_bytes) bytes = 0;
+	}
+
+	for (const char* area : {"instances", "pwads", "iwads"})
+		watch_tree(rootdir / area);
+
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(rootdir / "instances", ec)) {
+		if (!running) return;
+		if (entry.is_directory(ec)) read_references(entry.path());
+	}
+	changes++;
+}
+
+void DiskUsage::watch_tree(const path& dir) {
+	std::error_code ec;
+	if (!std::filesystem::is_directory(dir, ec)) return;
+	if (inotify_fd >= 0) {
+		int wd = inotify_add_watch(inotify_fd, dir.c_str(), watch_mask);
+		if (wd >= 0) watches[wd] = dir;
+	}
+
+	std::filesystem::directory_iterator dir_iter(dir,
+			std::filesystem::directory_options::skip_permission_denied, ec);
+	if (ec) return;
+	for (const auto& entry : dir_iter) {
+		if (!running) return;
+		if (entry.is_symlink(ec)) continue;
+		if (entry.is_directory(ec)) watch_tree(entry.path());
+		else if (entry.is_regular_file(ec)) update_file(entry.path());
+	}
+}
+
+void DiskUsage::handle_event(int wd, std::uint32_t mask, const char* name) {
+	auto watch = watches.find(wd);
+	if (watch == watches.end()) return;
+	if (mask & (IN_DELETE_SELF | IN_IGNORED)) {
+		watches.erase(watch);
+		return;
+	}
+
+	const path target = watch->second / name;
+	const bool is_dir = mask & IN_ISDIR;
+	if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+		if (is_dir) remove_tree(target);
+		else remove_file(target);
+	} else if (is_dir && (mask & (IN_CREATE | IN_MOVED_TO))) {
+		watch_tree(target);
+	} else if (mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO)) {
+		update_file(target);
+	}
+
+	if (area_of(target) != AREA_INSTANCES) return;
+	// A whole instance coming or going, or its config.json being rewritten,
+	// changes which pool files it holds on to.
+	if (target.filename() == "config.json" || target.parent_path() == rootdir / "instances")
+		read_references(instance_of(target));
+}
+
+void DiskUsage::update_file(const path& file) {
+	std::error_code ec;
+	std::uintmax_t size = std::filesystem::file_size(file, ec);
+	if (ec) return;
+
+	std::lock_guard<std::mutex> guard(lock);
+	auto [entry, inserted] = files.try_emplace(file.string(), 0);
+	const std::uintmax_t before = entry->second;
+	entry->second = size;
+	account(entry->first, before, size, true);
+}
+
+void DiskUsage::remove_file(const path& file) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto entry = files.find(file.string());
+	if (entry == files.end()) return;
+	account(entry->first, entry->second, 0, false);
+	files.erase(entry);
+}
+
+void DiskUsage::remove_tree(const path& dir) {
+	for (auto watch = watches.begin(); watch != watches.end();) {
+		const std::string watched = watch->second.string();
+		if (watched == dir.string() || watched.starts_with(dir.string() + "/")) {
+			inotify_rm_watch(inotify_fd, watch->first);
+			watch = watches.erase(watch);
+		} else watch++;
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	const std::string prefix = dir.string() + "/";
+	auto entry = files.lower_bound(prefix);
+	while (entry != files.end() && entry->first.starts_with(prefix)) {
+		account(entry->first, entry->second, 0, false);
+		entry = files.erase(entry);
+	}
+}
+
+void DiskUsage::read_references(const path& instance_dir) {
+	std::vector<std::string> refs{};
+	std::ifstream i(instance_dir / "config.json");
+	if (i.is_open()) {
+		json j = json::parse(i, nullptr, false);
+		if (!j.is_discarded()) {
+			if (j.contains("iwad_path") && j["iwad_path"].is_string())
+				refs.push_back(j["iwad_path"]);
+			if (j.contains("pwad_paths") && j["pwad_paths"].is_array())
+				for (const json& pwad : j["pwad_paths"])
+					if (pwad.is_string()) refs.push_back(pwad);
+		}
+	}
+	std::sort(refs.begin(), refs.end());
+	refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+
+	std::lock_guard<std::mutex> guard(lock);
+	std::error_code ec;
+	const bool exists = std::filesystem::is_directory(instance_dir, ec);
+	if (!exists) refs.clear();
+	// Only the references that came or went touch the totals.
+	std::vector<std::string>& previous = references[instance_dir];
+	for (const std::string& ref : previous)
+		if (!std::binary_search(refs.begin(), refs.end(), ref))
+			set_referrer(ref, instance_dir, false);
+	for (const std::string& ref : refs)
+		if (!std::binary_search(previous.begin(), previous.end(), ref))
+			set_referrer(ref, instance_dir, true);
+	if (!exists) {
+		references.erase(instance_dir);
+		instance_totals.erase(instance_dir);
+	} else previous = std::move(refs);
+	changes++;
+}
+
+// Caller holds the lock. before/after are the file's old and new sizes;
+// exists is false once it's gone.
+void DiskUsage::account(const std::string& file, std::uintmax_t before,
+		std::uintmax_t after, bool exists) {
+	AREA area = area_of(file);
+	area_bytes[area] += after - before;
+	if (area == AREA_INSTANCES) {
+		instance_totals[instance_of(file)].own_bytes += after - before;
+	} else if (area == AREA_PWADS || area == AREA_IWADS) {
+		charge_referrers(file, -1);
+		if (exists) pool_sizes[file] = after;
+		else pool_sizes.erase(file);
+		charge_referrers(file, 1);
+	}
+	changes++;
+}
+
+// Caller holds the lock. Adds (sign 1) or takes back (sign -1) a pool
+// file's bytes from every instance referencing it, as exclusive bytes if
+// it's the only one and shared otherwise.
+void DiskUsage::charge_referrers(const std::string& ref, int sign) {
+	auto size = pool_sizes.find(ref);
+	auto users = referrers.find(ref);
+	if (size == pool_sizes.end() || users == referrers.end()) return;
+	const bool shared = users->second.size() > 1;
+	for (const path& instance : users->second) {
+		instance_usage_t& totals = instance_totals[instance];
+		std::uintmax_t& bytes = shared ? totals.shared_bytes : totals.exclusive_bytes;
+		if (sign > 0) bytes += size->second;
+		else bytes -= size->second;
+	}
+}
+
+// Caller holds the lock. Changing who references a file can flip it
+// between exclusive and shared for everyone else, so its charge is taken
+// back and reapplied around the change.
+void DiskUsage::set_referrer(const std::string& ref, const path& instance, bool referenced) {
+	charge_referrers(ref, -1);
+	std::vector<path>& users = referrers[ref];
+	auto found = std::find(users.begin(), users.end(), instance);
+	if (referenced && found == users.end()) users.push_back(instance);
+	else if (!referenced && found != users.end()) users.erase(found);
+	const bool unused = users.empty();
+	charge_referrers(ref, 1);
+	if (unused) referrers.erase(ref);
+}
+
+DiskUsage::AREA DiskUsage::area_of(const path& file) const {
+	const path relative = file.lexically_relative(rootdir);
+	if (relative.empty()) return AREA_NONE;
+	const path top = *relative.begin();
+	if (top == "instances") return AREA_INSTANCES;
+	if (top == "pwads") return AREA_PWADS;
+	if (top == "iwads") return AREA_IWADS;
+	return AREA_NONE;
+}
+
+path DiskUsage::instance_of(const path& file) const {
+	const path relative = file.lexically_relative(rootdir / "instances");
+	if (relative.empty() || *relative.begin() == "..") return path("");
+	return rootdir / "instances" / *relative.begin();
+}
+
+std::string format_size(std::uintmax_t bytes) {
+	const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+	double size = bytes;
+	std::size_t unit = 0;
+	while (size >= 1024.0 && unit < 4) {
+		size /= 1024.0;
+		unit++;
+	}
+	char buffer[32];
+	if (unit == 0) snprintf(buffer, sizeof(buffer), "%ju %s", bytes, units[0]);
+	else snprintf(buffer, sizeof(buffer), "%.1f %s", size, units[unit]);
+	return std::string(buffer);
+}
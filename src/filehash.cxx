@@ -0,0 +1,157 @@
+#include "filehash.h"
+#include "wad.h"
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+using json=nlohmann::json;
+
+// Bumped whenever hash_file() changes, so stale hashes are thrown away.
+static constexpr int cache_version = 2;
+
+// XXH64, which takes the file eight bytes at a time in four independent
+// lanes instead of one byte per multiply.
+static constexpr std::uint64_t prime1 = 0x9e3779b185ebca87ull;
+static constexpr std::uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+static constexpr std::uint64_t prime3 = 0x165667b19e3779f9ull;
+static constexpr std::uint64_t prime4 = 0x85ebca77c2b2ae63ull;
+static constexpr std::uint64_t prime5 = 0x27d4eb2f165667c5ull;
+
+static inline std::uint64_t rotl(std::uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline std::uint64_t read64(const unsigned char* p) {
+	std::uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline std::uint32_t read32(const unsigned char* p) {
+	std::uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline std::uint64_t lane_round(std::uint64_t acc, std::uint64_t input) {
+	return rotl(acc + input * prime2, 31) * prime1;
+}
+
+static inline std::uint64_t lane_merge(std::uint64_t acc, std::uint64_t lane) {
+	return (acc ^ lane_round(0, lane)) * prime1 + prime4;
+}
+
+static std::uint64_t xxh64(const unsigned char* data, std::size_t size) {
+	const unsigned char* p = data;
+	const unsigned char* end = data + size;
+	std::uint64_t hash;
+	if (size >= 32) {
+		std::uint64_t v1 = prime1 + prime2;
+		std::uint64_t v2 = prime2;
+		std::uint64_t v3 = 0;
+		std::uint64_t v4 = -prime1;
+		for (; p + 32 <= end; p += 32) {
+			v1 = lane_round(v1, read64(p));
+			v2 = lane_round(v2, read64(p + 8));
+			v3 = lane_round(v3, read64(p + 16));
+			v4 = lane_round(v4, read64(p + 24));
+		}
+		hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		hash = lane_merge(hash, v1);
+		hash = lane_merge(hash, v2);
+		hash = lane_merge(hash, v3);
+		hash = lane_merge(hash, v4);
+	} else hash = prime5;
+	hash += size;
+
+	for (; p + 8 <= end; p += 8)
+		hash = rotl(hash ^ lane_round(0, read64(p)), 27) * prime1 + prime4;
+	if (p + 4 <= end) {
+		hash = rotl(hash ^ (read32(p) * prime1), 23) * prime2 + prime3;
+		p += 4;
+	}
+	for (; p < end; p++)
+		hash = rotl(hash ^ (*p * prime5), 11) * prime1;
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+std::uint64_t hash_file(const path& file) {
+	TRACE_SCOPE("fs.hash_file");
+	MappedFile mapped(file);
+	if (!mapped.valid()) return 0;
+	return xxh64(mapped.data(), mapped.size());
+}
+
+std::string hash_string(std::uint64_t hash) {
+	char buffer[17];
+	snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+	return std::string(buffer);
+}
+
+HashCache::HashCache(const path& cache_file) : cache_file(cache_file) {
+	std::ifstream i(cache_file);
+	if (!i.is_open()) return;
+	json j = json::parse(i, nullptr, false);
+	if (!j.is_object() || j.value("version", 1) != cache_version ||
+			!j.contains("files") || !j["files"].is_object()) return;
+	for (auto& [file, entry] : j["files"].items()) {
+		if (!entry.is_array() || entry.size() != 3) continue;
+		entries[file] = {
+			.size = entry[0],
+			.mtime = entry[1],
+			.hash = entry[2]
+		};
+	}
+}
+
+HashCache::~HashCache() {
+	save();
+}
+
+std::uint64_t HashCache::hash(const path& file) {
+	std::error_code ec;
+	const std::uintmax_t size = std::filesystem::file_size(file, ec);
+	if (ec) return 0;
+	const std::int64_t mtime =
+		std::filesystem::last_write_time(file, ec).time_since_epoch().count();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto find = entries.find(file.string());
+		if (find != entries.end() && find->second.size == size &&
+				find->second.mtime == mtime) {
+			trace::count(trace::CACHE_HITS);
+			return find->second.hash;
+		}
+	}
+	trace::count(trace::CACHE_MISSES);
+
+	const std::uint64_t hash = hash_file(file);
+	if (hash == 0) return 0;
+	std::lock_guard<std::mutex> guard(lock);
+	entries[file.string()] = {.size = size, .mtime = mtime, .hash = hash};
+	dirty = true;
+	return hash;
+}
+
+void HashCache::save() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (!dirty) return;
+	std::error_code ec;
+	std::filesystem::create_directories(cache_file.parent_path(), ec);
+	std::ofstream o(cache_file);
+	if (!o.is_open()) return;
+	json j = json::object();
+	j["version"] = cache_version;
+	j["files"] = json::object();
+	for (const auto& [file, entry] : entries)
+		j["files"][file] = {entry.size, entry.mtime, entry.hash};
+	o << j << std::endl;
+	dirty = false;
+}
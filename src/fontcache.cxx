@@ -0,0 +1,248 @@
+#include "fontcache.h"
+#include "trace.h"
+
+ImFont* add_ui_font(ImFontAtlas* atlas) {
+	ImFontConfig font_config;
+	font_config.SizePixels = 26.0f;
+	font_config.GlyphRanges = atlas->GetGlyphRangesDefault();
+	if (std::filesystem::exists("ProggyClean.ttf"))
+		return atlas->AddFontFromFileTTF("ProggyClean.ttf", 26.0f, &font_config);
+	// The same font, compiled into ImGui.
+	font_config.OversampleH = font_config.OversampleV = 1;
+	font_config.PixelSnapH = true;
+	return atlas->AddFontDefault(&font_config);
+}
+
+#if IMGUI_VERSION_NUM < 19200
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static constexpr std::uint32_t cache_version = 1;
+static constexpr std::size_t uv_line_count = IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1;
+
+struct baked_font_t {
+	float size;
+	float ascent;
+	float descent;
+	int metrics_total_surface;
+	std::vector<ImFontGlyph> glyphs;
+};
+
+struct baked_atlas_t {
+	int width;
+	int height;
+	ImVec2 uv_scale;
+	ImVec2 uv_white_pixel;
+	ImVec4 uv_lines[uv_line_count];
+	int pack_id_mouse_cursors;
+	int pack_id_lines;
+	std::vector<ImFontAtlasCustomRect> custom_rects;
+	std::vector<baked_font_t> fonts;
+	std::vector<unsigned char> pixels;
+};
+
+class Fnv {
+	public:
+	void add(const void* data, std::size_t size) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (std::size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+	}
+	template <typename T> void add(const T& value) { add(&value, sizeof(T)); }
+	[[nodiscard]] std::uint64_t value() const { return hash; }
+
+	private:
+	std::uint64_t hash = 0xcbf29ce484222325ull;
+};
+
+// Everything that goes into the baked output: the font files themselves
+// plus every setting that changes how they rasterise or pack.
+static std::uint64_t atlas_key(ImFontAtlas* atlas) {
+	Fnv fnv;
+	fnv.add(cache_version);
+	fnv.add(IMGUI_VERSION_NUM);
+	fnv.add(sizeof(ImFontGlyph));
+	fnv.add(atlas->Flags);
+	fnv.add(atlas->TexDesiredWidth);
+	fnv.add(atlas->TexGlyphPadding);
+	fnv.add(atlas->FontBuilderFlags);
+	fnv.add(atlas->Fonts.Size);
+	for (const ImFontConfig& config : atlas->ConfigData) {
+		fnv.add(config.FontData, config.FontDataSize);
+		fnv.add(config.FontNo);
+		fnv.add(config.SizePixels);
+		fnv.add(config.OversampleH);
+		fnv.add(config.OversampleV);
+		fnv.add(config.PixelSnapH);
+		fnv.add(config.GlyphExtraSpacing);
+		fnv.add(config.GlyphOffset);
+		fnv.add(config.GlyphMinAdvanceX);
+		fnv.add(config.GlyphMaxAdvanceX);
+		fnv.add(config.MergeMode);
+		fnv.add(config.FontBuilderFlags);
+		fnv.add(config.RasterizerMultiply);
+		fnv.add(config.EllipsisChar);
+		fnv.add(atlas->Fonts.find_index(config.DstFont));
+		const ImWchar* ranges = config.GlyphRanges ?
+			config.GlyphRanges : atlas->GetGlyphRangesDefault();
+		for (; ranges[0]; ranges += 2) {
+			fnv.add(ranges[0]);
+			fnv.add(ranges[1]);
+		}
+	}
+	return fnv.value();
+}
+
+static bool load_baked(const path& cache_file, std::uint64_t key, int font_count,
+		baked_atlas_t& baked) {
+	std::ifstream i(cache_file, std::ios::binary);
+	if (!i.is_open()) return false;
+	char magic[4];
+	std::uint32_t header[2];
+	std::uint64_t file_key;
+	i.read(magic, 4);
+	i.read((char*)header, sizeof(header));
+	i.read((char*)&file_key, sizeof(file_key));
+	if (!i || memcmp(magic, "DIFA", 4) != 0 || header[0] != cache_version ||
+			header[1] != (std::uint32_t)font_count || file_key != key) return false;
+
+	std::uint32_t count = 0;
+	i.read((char*)&baked.width, sizeof(baked.width));
+	i.read((char*)&baked.height, sizeof(baked.height));
+	i.read((char*)&baked.uv_scale, sizeof(baked.uv_scale));
+	i.read((char*)&baked.uv_white_pixel, sizeof(baked.uv_white_pixel));
+	i.read((char*)baked.uv_lines, sizeof(baked.uv_lines));
+	i.read((char*)&baked.pack_id_mouse_cursors, sizeof(baked.pack_id_mouse_cursors));
+	i.read((char*)&baked.pack_id_lines, sizeof(baked.pack_id_lines));
+	i.read((char*)&count, sizeof(count));
+	if (!i || baked.width <= 0 || baked.height <= 0 || count > 1 << 16) return false;
+	baked.custom_rects.resize(count);
+	i.read((char*)baked.custom_rects.data(), count * sizeof(ImFontAtlasCustomRect));
+
+	baked.fonts.resize(font_count);
+	for (baked_font_t& font : baked.fonts) {
+		i.read((char*)&font.size, sizeof(font.size));
+		i.read((char*)&font.ascent, sizeof(font.ascent));
+		i.read((char*)&font.descent, sizeof(font.descent));
+		i.read((char*)&font.metrics_total_surface, sizeof(font.metrics_total_surface));
+		i.read((char*)&count, sizeof(count));
+		if (!i || count > 1 << 20) return false;
+		font.glyphs.resize(count);
+		i.read((char*)font.glyphs.data(), count * sizeof(ImFontGlyph));
+	}
+
+	baked.pixels.resize((std::size_t)baked.width * baked.height);
+	i.read((char*)baked.pixels.data(), baked.pixels.size());
+	return (bool)i;
+}
+
+static void save_baked(const path& cache_file, std::uint64_t key, const ImFontAtlas* atlas) {
+	std::error_code ec;
+	std::filesystem::create_directories(cache_file.parent_path(), ec);
+	path temp = cache_file;
+	temp += ".tmp";
+	std::ofstream o(temp, std::ios::binary);
+	if (!o.is_open()) return;
+	const std::uint32_t header[2] = {cache_version, (std::uint32_t)atlas->Fonts.Size};
+	o.write("DIFA", 4);
+	o.write((const char*)header, sizeof(header));
+	o.write((const char*)&key, sizeof(key));
+
+	std::uint32_t count = atlas->CustomRects.Size;
+	o.write((const char*)&atlas->TexWidth, sizeof(atlas->TexWidth));
+	o.write((const char*)&atlas->TexHeight, sizeof(atlas->TexHeight));
+	o.write((const char*)&atlas->TexUvScale, sizeof(atlas->TexUvScale));
+	o.write((const char*)&atlas->TexUvWhitePixel, sizeof(atlas->TexUvWhitePixel));
+	o.write((const char*)atlas->TexUvLines, sizeof(ImVec4) * uv_line_count);
+	o.write((const char*)&atlas->PackIdMouseCursors, sizeof(atlas->PackIdMouseCursors));
+	o.write((const char*)&atlas->PackIdLines, sizeof(atlas->PackIdLines));
+	o.write((const char*)&count, sizeof(count));
+	o.write((const char*)atlas->CustomRects.Data, count * sizeof(ImFontAtlasCustomRect));
+
+	for (const ImFont* font : atlas->Fonts) {
+		count = font->Glyphs.Size;
+		o.write((const char*)&font->FontSize, sizeof(font->FontSize));
+		o.write((const char*)&font->Ascent, sizeof(font->Ascent));
+		o.write((const char*)&font->Descent, sizeof(font->Descent));
+		o.write((const char*)&font->MetricsTotalSurface, sizeof(font->MetricsTotalSurface));
+		o.write((const char*)&count, sizeof(count));
+		o.write((const char*)font->Glyphs.Data, count * sizeof(ImFontGlyph));
+	}
+
+	o.write((const char*)atlas->TexPixelsAlpha8, (std::size_t)atlas->TexWidth * atlas->TexHeight);
+	o.close();
+	if (o) std::filesystem::rename(temp, cache_file, ec);
+	else std::filesystem::remove(temp, ec);
+}
+
+// Does what ImFontAtlas::Build() leaves behind, minus the rasterising.
+static void restore_baked(ImFontAtlas* atlas, baked_atlas_t& baked) {
+	atlas->ClearTexData();
+	atlas->TexWidth = baked.width;
+	atlas->TexHeight = baked.height;
+	atlas->TexUvScale = baked.uv_scale;
+	atlas->TexUvWhitePixel = baked.uv_white_pixel;
+	memcpy(atlas->TexUvLines, baked.uv_lines, sizeof(baked.uv_lines));
+	atlas->TexPixelsAlpha8 = (unsigned char*)IM_ALLOC(baked.pixels.size());
+	memcpy(atlas->TexPixelsAlpha8, baked.pixels.data(), baked.pixels.size());
+
+	atlas->CustomRects.resize(baked.custom_rects.size());
+	for (std::size_t i = 0; i < baked.custom_rects.size(); i++) {
+		atlas->CustomRects[i] = baked.custom_rects[i];
+		atlas->CustomRects[i].Font = nullptr;
+	}
+	atlas->PackIdMouseCursors = baked.pack_id_mouse_cursors;
+	atlas->PackIdLines = baked.pack_id_lines;
+
+	for (int i = 0; i < atlas->Fonts.Size; i++) {
+		ImFont* font = atlas->Fonts[i];
+		baked_font_t& source = baked.fonts[i];
+		font->ClearOutputData();
+		font->ContainerAtlas = atlas;
+		font->ConfigData = nullptr;
+		font->ConfigDataCount = 0;
+		for (const ImFontConfig& config : atlas->ConfigData) {
+			if (config.DstFont != font) continue;
+			if (!font->ConfigData) font->ConfigData = &config;
+			font->ConfigDataCount++;
+		}
+		font->FontSize = source.size;
+		font->Ascent = source.ascent;
+		font->Descent = source.descent;
+		font->MetricsTotalSurface = source.metrics_total_surface;
+		font->Glyphs.resize(source.glyphs.size());
+		memcpy(font->Glyphs.Data, source.glyphs.data(), source.glyphs.size() * sizeof(ImFontGlyph));
+		font->BuildLookupTable();
+	}
+	atlas->TexReady = true;
+}
+
+bool build_font_atlas(ImFontAtlas* atlas, const path& cache_file) {
+	TRACE_SCOPE("font.build_atlas");
+	if (atlas->Fonts.empty()) return false;
+	const std::uint64_t key = atlas_key(atlas);
+	baked_atlas_t baked{};
+	if (load_baked(cache_file, key, atlas->Fonts.Size, baked)) {
+		restore_baked(atlas, baked);
+		return true;
+	}
+
+	if (!atlas->Build()) return false;
+	// Colour glyphs only ever come from FreeType and live in the RGBA
+	// texture, which isn't worth caching.
+	if (!atlas->TexPixelsUseColors && atlas->TexPixelsAlpha8) save_baked(cache_file, key, atlas);
+	return false;
+}
+
+#else
+
+bool build_font_atlas(ImFontAtlas*, const path&) {
+	return false;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "instance.h"
+#include <fstream>
+#include <nlohmann/json.hpp>
+using json=nlohmann::json;
+
+bool read_instance_config(const path& instance_dir, path& iwad_path,
+		std::vector<path>& pwad_paths, const PoolStack* pool) {
+	iwad_path.clear();
+	pwad_paths.clear();
+
+	std::ifstream i(instance_dir / "config.json");
+	if (!i.is_open()) return false;
+	json j = json::parse(i, nullptr, false);
+	if (!j.is_object()) return false;
+
+	auto locate = [&](const json& file, PoolStack::KIND kind) -> path {
+		if (!file.is_string()) return path();
+		const path stored = path(file);
+		if (std::filesystem::exists(stored)) return stored;
+		if (!pool) return path();
+		return pool->resolve(kind, stored.filename().string());
+	};
+	if (j.contains("iwad_path"))
+		iwad_path = locate(j["iwad_path"], PoolStack::IWADS);
+	if (j.contains("pwad_paths") && j["pwad_paths"].is_array()) {
+		for (json pwad : j["pwad_paths"]) {
+			const path located = locate(pwad, PoolStack::PWADS);
+			if (located.empty()) continue;
+			pwad_paths.push_back(located);
+		}
+	}
+	return true;
+}
+
+std::vector<std::string> launch_arguments(const path& gzdoom_path,
+		const path& instance_dir, const path& iwad_path,
+		const std::vector<path>& pwad_paths,
+		const std::vector<std::string>& extra_args) {
+	std::vector<std::string> args{
+		gzdoom_path.string(),
+		"-iwad", iwad_path.string(),
+		"-savedir", (instance_dir / "save").string(),
+		"-config", (instance_dir / "config").string(),
+		"-file",
+	};
+	for (const path& pwad_path : pwad_paths)
+		args.push_back(pwad_path.string());
+	args.insert(args.end(), extra_args.begin(), extra_args.end());
+	return args;
+}
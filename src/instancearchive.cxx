@@ -0,0 +1,668 @@
+#include "instancearchive.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <zip.h>
+#include <zlib.h>
+using json=nlohmann::json;
+
+static constexpr std::size_t block_size = 1 << 20;
+static constexpr std::size_t dictionary_size = 32768;
+static constexpr int manifest_version = 1;
+
+static void put16(std::vector<unsigned char>& out, std::uint16_t value) {
+	for (int i = 0; i < 2; i++) out.push_back(value >> (i * 8));
+}
+
+static void put32(std::vector<unsigned char>& out, std::uint32_t value) {
+	for (int i = 0; i < 4; i++) out.push_back(value >> (i * 8));
+}
+
+static void put64(std::vector<unsigned char>& out, std::uint64_t value) {
+	for (int i = 0; i < 8; i++) out.push_back(value >> (i * 8));
+}
+
+// Files that are already compressed gain nothing from another deflate pass.
+static bool should_deflate(const std::string& name) {
+	std::string extension = path(name).extension().string();
+	for (char& c : extension) c = tolower(c);
+	for (const char* stored : {".pk3", ".pk7", ".ipk3", ".zip", ".7z", ".zds", ".png",
+			".jpg", ".ogg", ".flac", ".mp3"})
+		if (extension == stored) return false;
+	return true;
+}
+
+// A zip64 writer that deflates fixed-size blocks on a thread pool and
+// writes them out in order. Each block is an independent raw deflate
+// stream primed with the previous block's last 32 KiB and ended with a
+// sync flush (the final block of an entry with Z_FINISH), so the blocks
+// concatenate into one valid stream, the same trick pigz uses.
+class ZipWriter {
+	public:
+	ZipWriter(FILE* out, unsigned int threads, archive_progress_t* progress) :
+			out(out), progress(progress) {
+		for (unsigned int i = 0; i < threads; i++)
+			workers.emplace_back(&ZipWriter::worker, this);
+		max_in_flight = threads * 4;
+	}
+
+	~ZipWriter() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& thread : workers) thread.join();
+	}
+
+	bool add_file(const std::string& name, const path& file) {
+		FILE* in = fopen(file.c_str(), "rb");
+		if (!in) return false;
+		struct stat sb;
+		fstat(fileno(in), &sb);
+		const std::size_t entry = begin_entry(name, sb.st_mtime, sb.st_mode & 0777);
+
+		bool last = false;
+		std::vector<unsigned char> dictionary{};
+		while (!last && ok) {
+			std::vector<unsigned char> input(block_size);
+			const std::size_t length = fread(input.data(), 1, block_size, in);
+			input.resize(length);
+			last = length < block_size;
+			std::vector<unsigned char> next_dictionary(
+					input.end() - std::min(input.size(), dictionary_size), input.end());
+			submit(entry, std::move(input), std::move(dictionary), last);
+			dictionary = std::move(next_dictionary);
+		}
+		fclose(in);
+		ops.push_back({.kind = op_t::DESCRIPTOR, .entry = entry});
+		return ok;
+	}
+
+	bool add_memory(const std::string& name, const std::string& contents) {
+		const std::size_t entry = begin_entry(name, time(nullptr), 0644);
+		submit(entry, std::vector<unsigned char>(contents.begin(), contents.end()), {}, true);
+		ops.push_back({.kind = op_t::DESCRIPTOR, .entry = entry});
+		return ok;
+	}
+
+	bool finish() {
+		drain(0);
+		if (!ok) return false;
+
+		const std::uint64_t cd_offset = written;
+		for (const entry_t& entry : entries) {
+			std::vector<unsigned char> header{};
+			put32(header, 0x02014b50);
+			put16(header, (3 << 8) | 45);
+			put16(header, 45);
+			put16(header, 0x0808);
+			put16(header, entry.deflate ? 8 : 0);
+			put16(header, entry.dos_time);
+			put16(header, entry.dos_date);
+			put32(header, entry.crc);
+			put32(header, 0xFFFFFFFF);
+			put32(header, 0xFFFFFFFF);
+			put16(header, entry.name.size());
+			put16(header, 28);
+			put16(header, 0);
+			put16(header, 0);
+			put16(header, 0);
+			put32(header, (0100000u | entry.mode) << 16);
+			put32(header, 0xFFFFFFFF);
+			header.insert(header.end(), entry.name.begin(), entry.name.end());
+			put16(header, 0x0001);
+			put16(header, 24);
+			put64(header, entry.usize);
+			put64(header, entry.csize);
+			put64(header, entry.offset);
+			write(header.data(), header.size());
+		}
+		const std::uint64_t cd_size = written - cd_offset;
+		const std::uint64_t eocd64_offset = written;
+
+		std::vector<unsigned char> trailer{};
+		put32(trailer, 0x06064b50);
+		put64(trailer, 44);
+		put16(trailer, (3 << 8) | 45);
+		put16(trailer, 45);
+		put32(trailer, 0);
+		put32(trailer, 0);
+		put64(trailer, entries.size());
+		put64(trailer, entries.size());
+		put64(trailer, cd_size);
+		put64(trailer, cd_offset);
+
+		put32(trailer, 0x07064b50);
+		put32(trailer, 0);
+		put64(trailer, eocd64_offset);
+		put32(trailer, 1);
+
+		// Readers only look at the zip64 record for fields maxed out here.
+		put32(trailer, 0x06054b50);
+		put16(trailer, 0);
+		put16(trailer, 0);
+		put16(trailer, std::min<std::size_t>(entries.size(), 0xFFFF));
+		put16(trailer, std::min<std::size_t>(entries.size(), 0xFFFF));
+		put32(trailer, std::min<std::uint64_t>(cd_size, 0xFFFFFFFF));
+		put32(trailer, std::min<std::uint64_t>(cd_offset, 0xFFFFFFFF));
+		put16(trailer, 0);
+		write(trailer.data(), trailer.size());
+		return ok;
+	}
+
+	[[nodiscard]] std::uint64_t bytes_written() const { return written; }
+
+	private:
+	struct entry_t {
+		std::string name;
+		bool deflate;
+		std::uint16_t dos_time;
+		std::uint16_t dos_date;
+		std::uint32_t mode;
+		std::uint64_t offset;
+		std::uint32_t crc;
+		std::uint64_t csize;
+		std::uint64_t usize;
+	};
+
+	struct block_t {
+		std::vector<unsigned char> data;
+		std::uint32_t crc;
+		std::uint64_t usize;
+	};
+
+	struct op_t {
+		enum {
+			HEADER,
+			BLOCK,
+			DESCRIPTOR,
+		} kind;
+		std::size_t entry;
+		std::future<block_t> block;
+	};
+
+	FILE* out;
+	archive_progress_t* progress;
+	bool ok = true;
+	std::uint64_t written = 0;
+	std::vector<entry_t> entries;
+	std::deque<op_t> ops;
+	std::size_t max_in_flight;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<std::packaged_task<block_t()>> tasks;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+
+	void worker() {
+		while (true) {
+			std::packaged_task<block_t()> task;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [&]() { return stopping || !tasks.empty(); });
+				if (tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	static block_t compress_block(std::vector<unsigned char> input,
+			std::vector<unsigned char> dictionary, bool last, bool deflate_block) {
+		block_t block{
+			.crc = (std::uint32_t)crc32(0, input.data(), input.size()),
+			.usize = input.size()
+		};
+		if (!deflate_block) {
+			block.data = std::move(input);
+			return block;
+		}
+
+		z_stream zs{};
+		deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+		if (!dictionary.empty())
+			deflateSetDictionary(&zs, dictionary.data(), dictionary.size());
+		block.data.resize(deflateBound(&zs, input.size()) + 16);
+		zs.next_in = input.data();
+		zs.avail_in = input.size();
+		zs.next_out = block.data.data();
+		zs.avail_out = block.data.size();
+		while (true) {
+			int res = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+			if (last ? res == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out > 0)) break;
+			const std::size_t used = block.data.size() - zs.avail_out;
+			block.data.resize(block.data.size() * 2);
+			zs.next_out = block.data.data() + used;
+			zs.avail_out = block.data.size() - used;
+		}
+		block.data.resize(zs.total_out);
+		deflateEnd(&zs);
+		return block;
+	}
+
+	std::size_t begin_entry(const std::string& name, time_t mtime, std::uint32_t mode) {
+		struct tm local;
+		localtime_r(&mtime, &local);
+		entries.push_back({
+			.name = name,
+			.deflate = should_deflate(name),
+			.dos_time = (std::uint16_t)((local.tm_hour << 11) | (local.tm_min << 5) |
+					(local.tm_sec / 2)),
+			.dos_date = (std::uint16_t)((std::max(local.tm_year - 80, 0) << 9) |
+					((local.tm_mon + 1) << 5) | local.tm_mday),
+			.mode = mode,
+			.offset = 0,
+			.crc = 0,
+			.csize = 0,
+			.usize = 0
+		});
+		ops.push_back({.kind = op_t::HEADER, .entry = entries.size() - 1});
+		return entries.size() - 1;
+	}
+
+	void submit(std::size_t entry, std::vector<unsigned char> input,
+			std::vector<unsigned char> dictionary, bool last) {
+		drain(max_in_flight);
+		std::packaged_task<block_t()> task(
+				[input = std::move(input), dictionary = std::move(dictionary), last,
+				deflate_block = entries[entry].deflate]() mutable {
+			return compress_block(std::move(input), std::move(dictionary), last, deflate_block);
+		});
+		op_t op{.kind = op_t::BLOCK, .entry = entry, .block = task.get_future()};
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			tasks.push_back(std::move(task));
+		}
+		wake.notify_one();
+		ops.push_back(std::move(op));
+	}
+
+	// Writes finished work out in order until at most keep ops are pending.
+	void drain(std::size_t keep) {
+		while (ops.size() > keep) {
+			op_t op = std::move(ops.front());
+			ops.pop_front();
+			entry_t& entry = entries[op.entry];
+			std::vector<unsigned char> header{};
+			switch (op.kind) {
+			case op_t::HEADER:
+				entry.offset = written;
+				put32(header, 0x04034b50);
+				put16(header, 45);
+				put16(header, 0x0808);
+				put16(header, entry.deflate ? 8 : 0);
+				put16(header, entry.dos_time);
+				put16(header, entry.dos_date);
+				put32(header, 0);
+				put32(header, 0xFFFFFFFF);
+				put32(header, 0xFFFFFFFF);
+				put16(header, entry.name.size());
+				put16(header, 20);
+				header.insert(header.end(), entry.name.begin(), entry.name.end());
+				put16(header, 0x0001);
+				put16(header, 16);
+				put64(header, 0);
+				put64(header, 0);
+				write(header.data(), header.size());
+				break;
+			case op_t::BLOCK: {
+				block_t block = op.block.get();
+				write(block.data.data(), block.data.size());
+				entry.crc = crc32_combine(entry.crc, block.crc, block.usize);
+				entry.csize += block.data.size();
+				entry.usize += block.usize;
+				if (progress) progress->done_bytes += block.usize;
+				break;
+			}
+			case op_t::DESCRIPTOR:
+				put32(header, 0x08074b50);
+				put32(header, entry.crc);
+				put64(header, entry.csize);
+				put64(header, entry.usize);
+				write(header.data(), header.size());
+				break;
+			}
+		}
+	}
+
+	void write(const void* data, std::size_t size) {
+		if (!ok) return;
+		if (fwrite(data, 1, size, out) != size) ok = false;
+		written += size;
+	}
+};
+
+static bool safe_relative(const path& relative) {
+	if (relative.empty() || relative.is_absolute()) return false;
+	for (const path& part : relative)
+		if (part == "..") return false;
+	return true;
+}
+
+static std::uint64_t content_hash(HashCache* hashes, const path& file) {
+	return hashes ? hashes->hash(file) : hash_file(file);
+}
+
+export_result_t export_instance(const path& rootdir, const path& instance_dir,
+		const path& archive, bool include_pool, HashCache* hashes,
+		archive_progress_t* progress, unsigned int threads) {
+	TRACE_SCOPE("zip.export_instance");
+	auto start = std::chrono::steady_clock::now();
+	export_result_t result{.ok = false, .input_bytes = 0, .output_bytes = 0, .seconds = 0};
+	std::error_code ec;
+	if (!std::filesystem::is_directory(instance_dir, ec)) {
+		result.error = "Instance directory does not exist.";
+		return result;
+	}
+
+	std::vector<std::pair<std::string, path>> files{};
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(instance_dir, ec)) {
+		if (!entry.is_regular_file(ec)) continue;
+		files.push_back({"instance/" +
+				entry.path().lexically_relative(instance_dir).generic_string(), entry.path()});
+		result.input_bytes += entry.file_size(ec);
+	}
+
+	std::vector<std::string> refs{};
+	std::ifstream i(instance_dir / "config.json");
+	json config = json::parse(i, nullptr, false);
+	if (config.is_object()) {
+		if (config.contains("iwad_path") && config["iwad_path"].is_string())
+			refs.push_back(config["iwad_path"]);
+		if (config.contains("pwad_paths") && config["pwad_paths"].is_array())
+			for (const json& pwad : config["pwad_paths"])
+				if (pwad.is_string()) refs.push_back(pwad);
+	}
+
+	json manifest;
+	manifest["version"] = manifest_version;
+	manifest["instance"] = instance_dir.filename().string();
+	manifest["pool"] = json::array();
+	for (const std::string& ref : refs) {
+		const path pool_file(ref);
+		if (!std::filesystem::is_regular_file(pool_file, ec)) continue;
+		const std::string kind = pool_file.parent_path().filename() == "iwads" ?
+			"iwads" : "pwads";
+		const std::string archive_name = "pool/" + kind + "/" + pool_file.filename().string();
+		const std::uintmax_t size = std::filesystem::file_size(pool_file, ec);
+		manifest["pool"].push_back({
+			{"kind", kind},
+			{"name", pool_file.filename().string()},
+			{"original", ref},
+			{"hash", hash_string(content_hash(hashes, pool_file))},
+			{"size", size},
+			{"included", include_pool}
+		});
+		if (!include_pool) continue;
+		files.push_back({archive_name, pool_file});
+		result.input_bytes += size;
+	}
+	if (progress) progress->total_bytes = result.input_bytes;
+
+	path partial = archive;
+	partial += ".part";
+	FILE* out = fopen(partial.c_str(), "wb");
+	if (!out) {
+		result.error = "Could not open " + partial.string() + " for writing.";
+		return result;
+	}
+	setvbuf(out, nullptr, _IOFBF, block_size);
+
+	bool ok;
+	std::uint64_t written;
+	{
+		ZipWriter writer(out, threads ? threads :
+				std::max(1u, std::thread::hardware_concurrency()), progress);
+		ok = writer.add_memory("manifest.json", manifest.dump(1, '\t'));
+		for (const auto& [name, file] : files)
+			if (ok) ok = writer.add_file(name, file);
+		if (ok) ok = writer.finish();
+		written = writer.bytes_written();
+	}
+	if (fclose(out) != 0) ok = false;
+
+	if (!ok) {
+		std::filesystem::remove(partial, ec);
+		result.error = "Failed writing " + archive.string() + ".";
+		return result;
+	}
+	std::filesystem::rename(partial, archive, ec);
+	if (ec) {
+		result.error = ec.message();
+		return result;
+	}
+	if (hashes) hashes->save();
+
+	result.ok = true;
+	result.output_bytes = written;
+	result.seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+static bool extract_entry(zip_t* z, zip_int64_t index, const path& target,
+		archive_progress_t* progress) {
+	zip_file_t* f = zip_fopen_index(z, index, 0);
+	if (!f) return false;
+	std::error_code ec;
+	std::filesystem::create_directories(target.parent_path(), ec);
+	std::ofstream o(target, std::ios::binary);
+	std::vector<char> buffer(block_size);
+	zip_int64_t length;
+	while ((length = zip_fread(f, buffer.data(), buffer.size())) > 0) {
+		o.write(buffer.data(), length);
+		if (progress) progress->done_bytes += length;
+	}
+	zip_fclose(f);
+	o.close();
+	return length == 0 && (bool)o;
+}
+
+import_result_t import_instance(const path& rootdir, const path& archive,
+		HashCache* hashes, archive_progress_t* progress, const PoolStack* pool) {
+	TRACE_SCOPE("zip.import_instance");
+	import_result_t result{
+		.ok = false,
+		.pool_files_written = 0,
+		.pool_files_skipped = 0,
+		.pool_files_missing = 0
+	};
+	int err;
+	zip_t* z = zip_open(archive.c_str(), ZIP_RDONLY, &err);
+	if (!z) {
+		result.error = "Could not open " + archive.string() + ".";
+		return result;
+	}
+
+	json manifest;
+	{
+		zip_stat_t sb;
+		zip_stat_init(&sb);
+		zip_file_t* f = zip_stat(z, "manifest.json", 0, &sb) == 0 ?
+			zip_fopen(z, "manifest.json", 0) : nullptr;
+		if (f) {
+			std::string contents(sb.size, '\0');
+			zip_fread(f, contents.data(), sb.size);
+			zip_fclose(f);
+			manifest = json::parse(contents, nullptr, false);
+		}
+	}
+	if (!manifest.is_object() || manifest.value("version", 0) != manifest_version ||
+			!manifest.contains("instance") || !manifest["instance"].is_string()) {
+		zip_close(z);
+		result.error = "Not an instance archive.";
+		return result;
+	}
+
+	std::error_code ec;
+	std::string name = path(std::string(manifest["instance"])).filename().string();
+	if (name.empty() || name == "." || name == "..") name = "imported";
+	result.instance_name = name;
+	for (int n = 2; std::filesystem::exists(rootdir / "instances" / result.instance_name); n++)
+		result.instance_name = name + "-" + std::to_string(n);
+	// Staged outside instances/ so a half-extracted import never shows up
+	// in the instance list or the disk usage totals.
+	const path staging = rootdir / "cache" / "import" / result.instance_name;
+	std::filesystem::remove_all(staging, ec);
+	// New pool files wait next to it until they've been checked against
+	// the manifest and the instance is in place; staged -> final name.
+	const path pool_staging = rootdir / "cache" / "import" / (result.instance_name + ".pool");
+	std::filesystem::remove_all(pool_staging, ec);
+	std::vector<std::pair<path, path>> pool_moves{};
+	auto pending = [&](const path& target) {
+		return std::any_of(pool_moves.begin(), pool_moves.end(),
+			[&](const std::pair<path, path>& move) { return move.second == target; });
+	};
+
+	if (progress) {
+		std::uintmax_t total = 0;
+		for (zip_int64_t i = 0; i < zip_get_num_entries(z, 0); i++) {
+			zip_stat_t sb;
+			zip_stat_init(&sb);
+			if (zip_stat_index(z, i, 0, &sb) == 0) total += sb.size;
+		}
+		progress->total_bytes = total;
+	}
+
+	bool ok = true;
+	for (zip_int64_t i = 0; ok && i < zip_get_num_entries(z, 0); i++) {
+		const char* entry_name = zip_get_name(z, i, 0);
+		if (!entry_name) continue;
+		const std::string entry = entry_name;
+		if (!entry.starts_with("instance/") || entry.ends_with("/")) continue;
+		const path relative = path(entry.substr(9)).lexically_normal();
+		if (!safe_relative(relative)) continue;
+		ok = extract_entry(z, i, staging / relative, progress);
+	}
+	std::filesystem::create_directories(staging / "save", ec);
+
+	// Reuse any pool file with the same contents instead of importing a
+	// second copy; only genuinely new files get extracted.
+	std::unordered_map<std::string, std::string> remap{};
+	if (manifest.contains("pool") && manifest["pool"].is_array()) {
+		for (const json& pool_entry : manifest["pool"]) {
+			if (!ok) break;
+			const std::string kind = pool_entry.value("kind", "pwads") == "iwads" ?
+				"iwads" : "pwads";
+			const std::string file_name = path(pool_entry.value("name", "")).filename().string();
+			const std::string hash = pool_entry.value("hash", "");
+			const std::uintmax_t size = pool_entry.value("size", (std::uintmax_t)0);
+			const std::string original = pool_entry.value("original", "");
+			if (file_name.empty()) continue;
+
+			path resolved{};
+			const path candidate = rootdir / kind / file_name;
+			const PoolStack::KIND pool_kind = kind == "iwads" ? PoolStack::IWADS : PoolStack::PWADS;
+			const path visible = pool ? pool->resolve(pool_kind, file_name) : candidate;
+			if (!visible.empty() && std::filesystem::exists(visible, ec) &&
+					hash_string(content_hash(hashes, visible)) == hash)
+				resolved = visible;
+			std::vector<path> local_files{};
+			if (pool) local_files = pool->list(pool_kind);
+			else for (const auto& local : std::filesystem::directory_iterator(rootdir / kind, ec))
+				local_files.push_back(local.path());
+			for (const path& local : local_files) {
+				if (!resolved.empty()) break;
+				if (!std::filesystem::is_regular_file(local, ec) ||
+						std::filesystem::file_size(local, ec) != size) continue;
+				if (hash_string(content_hash(hashes, local)) == hash) resolved = local;
+			}
+			if (!resolved.empty()) {
+				result.pool_files_skipped++;
+				if (progress) progress->done_bytes += size;
+			} else {
+				const zip_int64_t index =
+					zip_name_locate(z, ("pool/" + kind + "/" + file_name).c_str(), 0);
+				if (index < 0) {
+					result.pool_files_missing++;
+					continue;
+				}
+				resolved = candidate;
+				if (std::filesystem::exists(resolved, ec) || pending(resolved))
+					resolved = rootdir / kind / (path(file_name).stem().string() + "-" +
+						hash.substr(0, 8) + path(file_name).extension().string());
+				const path staged = pool_staging / kind / resolved.filename();
+				if (!extract_entry(z, index, staged, progress)) {
+					ok = false;
+					break;
+				}
+				if (hash_string(hash_file(staged)) != hash) {
+					ok = false;
+					result.error = file_name + " in " + archive.string() +
+						" does not match its manifest hash.";
+					break;
+				}
+				pool_moves.emplace_back(staged, resolved);
+			}
+			remap[original] = resolved.string();
+		}
+	}
+	zip_close(z);
+
+	// Point config.json at this machine's pool.
+	std::ifstream i(staging / "config.json");
+	json config = json::parse(i, nullptr, false);
+	i.close();
+	if (ok && config.is_object()) {
+		auto local_path = [&](const json& value) -> json {
+			if (!value.is_string()) return value;
+			auto find = remap.find(value);
+			return find == remap.end() ? value : json(find->second);
+		};
+		if (config.contains("iwad_path"))
+			config["iwad_path"] = local_path(config["iwad_path"]);
+		if (config.contains("pwad_paths") && config["pwad_paths"].is_array())
+			for (json& pwad : config["pwad_paths"]) pwad = local_path(pwad);
+		std::ofstream o(staging / "config.json");
+		o << config << std::endl;
+	}
+
+	if (!ok) {
+		std::filesystem::remove_all(staging, ec);
+		std::filesystem::remove_all(pool_staging, ec);
+		if (result.error.empty()) result.error = "Failed extracting " + archive.string() + ".";
+		return result;
+	}
+	const path instance_dir = rootdir / "instances" / result.instance_name;
+	std::filesystem::rename(staging, instance_dir, ec);
+	if (ec) {
+		std::filesystem::remove_all(staging, ec);
+		std::filesystem::remove_all(pool_staging, ec);
+		result.error = "Failed to move imported instance into place.";
+		return result;
+	}
+	for (std::size_t moved = 0; moved < pool_moves.size(); moved++) {
+		std::filesystem::rename(pool_moves[moved].first, pool_moves[moved].second, ec);
+		if (!ec) continue;
+		// Undo the whole import rather than leave an instance that points
+		// at pool files that never arrived.
+		for (std::size_t undo = 0; undo < moved; undo++)
+			std::filesystem::remove(pool_moves[undo].second, ec);
+		std::filesystem::remove_all(instance_dir, ec);
+		std::filesystem::remove_all(pool_staging, ec);
+		result.error = "Failed to move imported pool files into place.";
+		return result;
+	}
+	std::filesystem::remove_all(pool_staging, ec);
+	result.pool_files_written = pool_moves.size();
+	if (hashes) hashes->save();
+	result.ok = true;
+	return result;
+}
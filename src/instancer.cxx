@@ -0,0 +1,1322 @@
+#include "instancer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include "imgui.h"
+#include "guiconf.h"
+#include "instance.h"
+#include "trace.h"
+#include "unistd.h"
+#include "portable-file-dialogs.h"
+#include <zip.h>
+using json=nlohmann::json;
+
+path GZDoomInstancer::default_rootdir() {
+	return path(getenv("HOME")) / path(".doominstancer");
+}
+
+GZDoomInstancer::GZDoomInstancer() : GZDoomInstancer(default_rootdir()) {}
+
+GZDoomInstancer::GZDoomInstancer(const path& rootdir, bool headless) : rootdir(rootdir) {
+	if (!std::filesystem::exists(rootdir))
+		std::filesystem::create_directory(rootdir);
+	if (!std::filesystem::exists(rootdir / "pwads"))
+		std::filesystem::create_directory(rootdir / "pwads");
+	if (!std::filesystem::exists(rootdir / "instances"))
+		std::filesystem::create_directory(rootdir / "instances");
+	if (!std::filesystem::exists(rootdir / "iwads"))
+		std::filesystem::create_directory(rootdir / "iwads");
+	if (!std::filesystem::exists(rootdir / "logs"))
+		std::filesystem::create_directory(rootdir / "logs");
+
+	iwad_path = "";
+	pwad_paths.clear();
+	current_idgames_path = "";
+	current_idgames_details = {.discovered=false};
+	pool = new PoolStack(rootdir);
+	mirrors = new MirrorSet(rootdir / "mirrors.json");
+	if (!headless) mirrors->start();
+	refresh_available_pwads();
+	available_instance_paths = list_instances();
+	available_iwad_paths = list_iwads();
+	if (!headless && iga_ping()) {
+		available_idgames_paths = iga_getdirs();
+	}
+	#ifdef WIN32
+	gzdoom_path = "";
+	#else
+	gzdoom_path = "/usr/games/gzdoom";
+	#endif
+	api_url = "https://www.doomworld.com/idgames/";
+	api_filename = "api/api.php";
+
+	disk_usage = new DiskUsage(rootdir);
+	if (!headless) disk_usage->start();
+	file_hashes = new HashCache(rootdir / "cache" / "hashes.json");
+	thumbnails = new ThumbnailCache(rootdir / "cache" / "thumbnails", file_hashes);
+	demo_benchmark = new DemoBenchmark(rootdir / "benchmarks.json", rootdir / "logs",
+			rootdir / "cache" / "benchmark");
+}
+
+GZDoomInstancer::~GZDoomInstancer() {
+	if (archive_job.valid()) archive_job.wait();
+	delete demo_benchmark;
+	delete thumbnails;
+	delete file_hashes;
+	delete disk_usage;
+	delete mirrors;
+	delete pool;
+}
+
+std::vector<std::string> GZDoomInstancer::darc_filters() {
+	return {"Doom Archives", "*.wad *.WAD *.pk3 *.PK3"};
+}
+
+const char* GZDoomInstancer::signature() {
+	return "GZDoom Instancer is FOSS developed by @timerunner16.";
+}
+
+const path GZDoomInstancer::iwad_dialog() {
+	pfd::open_file file_selector("Select IWAD", ".",
+			darc_filters(), pfd::opt::none);
+	const std::vector<std::string> result = file_selector.result();
+	if (result.empty()) return path("");
+	return path(result[0]);
+}
+
+const std::vector<path> GZDoomInstancer::pwad_dialog() {
+	pfd::open_file file_selector("Select PWADs", ".",
+			darc_filters(), pfd::opt::multiselect);
+	const std::vector<std::string> result = file_selector.result();
+	std::vector<path> paths{};
+	for (std::string i : result)
+		paths.push_back(path(i));
+	return paths;
+}
+
+const path GZDoomInstancer::gzdoom_dialog() {
+	pfd::open_file file_selector("Select GZDoom Executable", ".",
+			{"All Files", "*"}, pfd::opt::none);
+	const std::vector<std::string> result = file_selector.result();
+	if (result.empty()) return path("");
+	return path(result[0]);
+}
+
+void GZDoomInstancer::add_pwad() {
+	std::vector<path> pwad_paths = pwad_dialog();
+	for (path pwad_path : pwad_paths)
+		std::filesystem::copy_file(pwad_path, rootdir / "pwads" / pwad_path.filename());
+}
+
+void GZDoomInstancer::add_iwad() {
+	path iwad_path = iwad_dialog();
+	std::filesystem::copy_file(iwad_path, rootdir / "iwads" / iwad_path.filename());
+}
+
+std::size_t GZDoomInstancer::write_memory_cb(void* contents, std::size_t size, std::size_t nmemb,
+			void* userp) {
+	std::size_t realsize = size*nmemb;
+	memory_chunk* mem = (memory_chunk*)userp;
+	char* ptr = (char*)realloc(mem->data, mem->size + realsize + 1);
+	if (!ptr) {
+		std::cout << "Not enough memory\n" << std::endl;
+		return 0;
+	}
+
+	mem->data = ptr;
+	memcpy(&(mem->data[mem->size]), contents, realsize);
+	mem->size += realsize;
+	mem->data[mem->size] = 0;
+
+	return realsize;
+}
+
+const bool GZDoomInstancer::iga_ping() {
+	CURL* curl = curl_easy_init();
+	if (!curl) return false;
+	CURLcode res;
+
+	memory_chunk* chunk;
+	std::string full_url = api_url + api_filename + "?action=ping&out=json";
+	iga_prepare_curl(full_url.c_str(), curl, &chunk);
+
+	res = iga_perform(curl);
+
+	if (res != CURLE_OK) {
+		free(chunk->data);
+		delete chunk;
+		curl_easy_cleanup(curl);
+
+		return false;
+	}
+
+	std::string result = std::string(chunk->data);
+	try {
+		json j = json::parse(result);
+
+		free(chunk->data);
+		delete chunk;
+		curl_easy_cleanup(curl);
+
+		return true;
+	} catch (std::exception e) {
+		free(chunk->data);
+		delete chunk;
+		curl_easy_cleanup(curl);
+
+		return false;
+	}
+}
+
+const std::vector<path> GZDoomInstancer::iga_getdirs() {
+	CURL* curl = curl_easy_init();
+	if (!curl) return {};
+	CURLcode res;
+
+	memory_chunk* chunk;
+	std::string full_url = api_url + api_filename + "?action=getdirs&out=json&name=" +
+		current_idgames_path.string();
+	iga_prepare_curl(full_url.c_str(), curl, &chunk);
+
+	res = iga_perform(curl);
+
+	if (res != CURLE_OK) return {};
+	std::string result = std::string(chunk->data);
+
+	free(chunk->data);
+	delete chunk;
+	curl_easy_cleanup(curl);
+
+	return iga_parse_dirs(result);
+}
+
+const std::vector<path> GZDoomInstancer::iga_parse_dirs(const std::string& result) {
+	TRACE_SCOPE("json.iga_parse_dirs");
+	json j = json::parse(result);
+	if (!j.contains("content")) return {};
+	std::vector<path> paths{};
+	for (json result : j["content"]["dir"]) {
+		paths.push_back(result["name"]);
+	}
+	return paths;
+}
+
+const std::vector<path> GZDoomInstancer::iga_getfiles() {
+	CURL* curl = curl_easy_init();
+	if (!curl) return {};
+	CURLcode res;
+
+	memory_chunk* chunk;
+	std::string full_url = api_url + api_filename + "?action=getfiles&out=json&name=" +
+		current_idgames_path.c_str();
+	iga_prepare_curl(full_url.c_str(), curl, &chunk);
+
+	res = iga_perform(curl);
+
+	if (res != CURLE_OK) return {};
+	std::string result = std::string(chunk->data);
+
+	free(chunk->data);
+	delete chunk;
+	curl_easy_cleanup(curl);
+
+	return iga_parse_files(result);
+}
+
+const std::vector<path> GZDoomInstancer::iga_parse_files(const std::string& result) {
+	TRACE_SCOPE("json.iga_parse_files");
+	json j = json::parse(result);
+	if (!j.contains("content")) return {};
+	std::vector<path> paths{};
+	for (json result : j["content"]["file"]) {
+		paths.push_back(path(result["dir"]) / path(result["filename"]));
+	}
+	return paths;
+}
+
+GZDoomInstancer::iga_details_t GZDoomInstancer::iga_getdetails(path filename) {
+	CURL* curl = curl_easy_init();
+	if (!curl) return {.discovered = false};
+	CURLcode res;
+	memory_chunk* chunk;
+	std::string full_url = api_url + api_filename + "?action=get&out=json&file=" +
+		filename.generic_string();
+	iga_prepare_curl(full_url.c_str(), curl, &chunk);
+
+	res = iga_perform(curl);
+
+	if (res != CURLE_OK) return {.discovered = false};
+	std::string result = std::string(chunk->data);
+
+	free(chunk->data);
+	delete chunk;
+	curl_easy_cleanup(curl);
+
+	return iga_parse_details(result);
+}
+
+GZDoomInstancer::iga_details_t GZDoomInstancer::iga_parse_details(const std::string& result) {
+	TRACE_SCOPE("json.iga_parse_details");
+	json j = json::parse(result);
+	return {
+		.discovered = true,
+		.filename = j["content"]["filename"],
+		.name = j["content"]["title"],
+		.id = j["content"]["id"],
+		.description = j["content"]["description"],
+		.rating = j["content"]["rating"],
+		.votes = j["content"]["votes"]
+	};
+}
+
+void GZDoomInstancer::iga_downloadfile(path filename) {
+	TRACE_SCOPE("net.iga_downloadfile");
+	std::filesystem::create_directories(rootdir / "downloads");
+	path temp_output = rootdir / "downloads/temp.zip";
+	MirrorSet::result_t result = mirrors->download(filename.generic_string(), temp_output);
+	if (!result.ok) {
+		pfd::message error("IDGames Download",
+				"Couldn't download " + filename.string() + ": " + result.error,
+				pfd::choice::ok, pfd::icon::error);
+		error.result();
+		return;
+	}
+
+	pfd::notify notify("IDGames Download",
+			"PWAD Download finished, beginning install.", pfd::icon::info);
+	notify.ready();
+
+	iga_extract(temp_output);
+	std::filesystem::remove(temp_output);
+}
+
+void GZDoomInstancer::iga_extract(const path& archive) {
+	TRACE_SCOPE("zip.extract");
+	int err;
+	zip_t* z = zip_open(archive.c_str(), ZIP_RDONLY, &err);
+	if (!z) return;
+
+	for (std::size_t i = 0; i < zip_get_num_entries(z, 0); i++) {
+		zip_stat_t sb;
+		zip_stat_init(&sb);
+		if (zip_stat_index(z, i, 0, &sb) != 0) continue;
+		std::string outname = std::string(sb.name);
+
+		if (outname.ends_with(".txt")) continue;
+
+		char* contents = new char[sb.size];
+		zip_file* f = zip_fopen_index(z, i, 0);
+		if (f) {
+			zip_fread(f, contents, sb.size);
+			zip_fclose(f);
+		}
+
+		std::ofstream(rootdir / "pwads" / outname).write(contents, sb.size);
+		delete[] contents;
+	}
+	zip_close(z);
+}
+
+void GZDoomInstancer::launch_doom() {
+	const path instance_path = available_instance_paths[current_instance_index];
+	if (!std::filesystem::exists(instance_path)) return;
+	if (!std::filesystem::is_directory(instance_path)) return;
+	if (!std::filesystem::exists(gzdoom_path)) return;
+	if (std::filesystem::is_directory(gzdoom_path)) return;
+	if (std::filesystem::perms::none == 
+			(std::filesystem::status(gzdoom_path).permissions() &
+			std::filesystem::perms::owner_exec)) return;
+	if (fork() == 0) {
+		load_instance();
+		const std::vector<std::string> args = launch_arguments(gzdoom_path,
+				instance_path, iwad_path, pwad_paths.paths());
+		const char** argv = new const char*[args.size()+1];
+		for (std::size_t i = 0; i < args.size(); i++)
+			argv[i] = args[i].c_str();
+		argv[args.size()] = nullptr;
+
+		auto now = std::chrono::system_clock::now();
+		std::time_t now_time = std::chrono::system_clock::to_time_t(now);
+		char timestr[64];
+		std::strftime(timestr, sizeof(timestr), "%d-%m-%Y-%T", std::localtime(&now_time));
+		path logname = rootdir / "logs" / path(timestr);
+		int fd = open(logname.c_str(),
+				O_CREAT | O_TRUNC | O_WRONLY,
+				S_IRUSR | S_IWUSR);
+		dup2(fd, STDOUT_FILENO);
+
+		execvp(gzdoom_path.c_str(), const_cast<char* const*>(argv));
+	} else if (close_on_launch) {
+		exit(EXIT_SUCCESS);
+	}
+}
+
+const std::vector<path> GZDoomInstancer::list_instances() {
+	TRACE_SCOPE("fs.list_instances");
+	std::filesystem::directory_iterator dir_iter(rootdir / "instances");
+	std::vector<path> available_instance_paths{};
+	for (path instance_path : dir_iter)
+		available_instance_paths.push_back(instance_path);
+	std::sort(available_instance_paths.begin(), available_instance_paths.end());
+	return available_instance_paths;
+}
+
+const std::vector<path> GZDoomInstancer::list_iwads() {
+	TRACE_SCOPE("fs.list_iwads");
+	pool->refresh();
+	return pool->list(PoolStack::IWADS);
+}
+
+const std::vector<path> GZDoomInstancer::list_available_pwads() {
+	TRACE_SCOPE("fs.list_available_pwads");
+	pool->refresh();
+	return pool->list(PoolStack::PWADS);
+}
+
+void GZDoomInstancer::refresh_available_pwads() {
+	available_pwad_paths = list_available_pwads();
+	pwad_selection.reset(available_pwad_paths.size());
+	filter_pwads();
+}
+
+void GZDoomInstancer::filter_pwads() {
+	TRACE_SCOPE("editor.filter_pwads");
+	std::string filter = pwad_filter;
+	for (char& c : filter) c = tolower(c);
+	visible_pwads.clear();
+	for (std::size_t i = 0; i < available_pwad_paths.size(); i++) {
+		if (!filter.empty()) {
+			std::string name = available_pwad_paths[i].filename().string();
+			for (char& c : name) c = tolower(c);
+			if (name.find(filter) == std::string::npos) continue;
+		}
+		visible_pwads.push_back(i);
+	}
+	// Delete, Activate and Deactivate act on the selection, so it never
+	// holds rows the filter hides.
+	pwad_selection.retain(visible_pwads);
+}
+
+std::vector<path> GZDoomInstancer::selected_pwads() const {
+	std::vector<path> selected{};
+	selected.reserve(pwad_selection.size());
+	for (std::size_t i : pwad_selection.sorted()) selected.push_back(available_pwad_paths[i]);
+	return selected;
+}
+
+const char* GZDoomInstancer::path_string_getter(void* data, int index) {
+	path* paths = (path*)data;
+	path& path_selected = paths[index];
+	std::ptrdiff_t offset = path_selected.string().length() -
+		path_selected.filename().string().length();
+	if (path_selected.filename().string().length() == 0) {
+		std::string path_string = path_selected.string();
+		while (path_string.find("/") != path_string.size()-1) {
+			path_string = path_string.substr(path_string.find("/")+1);
+		}
+		offset = path_selected.string().length() - path_string.length();
+	}
+	return path_selected.c_str() + offset;
+}
+
+void GZDoomInstancer::load_instance() {
+	TRACE_SCOPE("instance.load");
+	const path instance_path = available_instance_paths[current_instance_index];
+	if (!std::filesystem::exists(instance_path)) return;
+	std::vector<path> pwads{};
+	read_instance_config(instance_path, iwad_path, pwads, pool);
+	pwad_paths.assign(pwads);
+}
+
+void GZDoomInstancer::save_instance() {
+	TRACE_SCOPE("instance.save");
+	if (!std::filesystem::exists(rootdir)) return;
+	if (!std::filesystem::exists(rootdir / "instances")) return;
+	
+	path instance_path = rootdir / "instances" / new_instance_name;
+	if (std::filesystem::exists(instance_path)) {
+		pfd::message overwrite("WARNING!",
+				"Really overwrite instance " +
+				instance_path.filename().string() + "? This is not reversible!",
+				pfd::choice::ok_cancel, pfd::icon::warning);
+		if (overwrite.result() != pfd::button::ok) return;
+	} else {
+		std::filesystem::create_directory(rootdir / "instances" / new_instance_name);
+		std::filesystem::create_directory(rootdir / "instances" / new_instance_name / "save");
+	}
+
+	std::ofstream o(instance_path / "config.json");
+	if (!o.is_open()) {
+		std::cout << "couldnt open " << rootdir/new_instance_name
+			<< " in ostream to save" << std::endl;
+		return;
+	}
+	json j;
+	j["iwad_path"] = iwad_path;
+	j["pwad_paths"] = {};
+	for (path pwad : pwad_paths) {
+		j["pwad_paths"].push_back(pwad);
+	}
+	o << j << std::endl;
+	o.flush();
+	o.close();
+}
+
+void GZDoomInstancer::delete_instance() {
+	const path instance_path = available_instance_paths[current_instance_index];
+	if (!std::filesystem::exists(instance_path)) return;
+	pfd::message message("WARNING!",
+			"Really delete " +
+			instance_path.filename().string() + "? This is not reversible!",
+			pfd::choice::ok_cancel, pfd::icon::warning);
+	if (message.result() != pfd::button::ok) return;
+	std::filesystem::remove_all(instance_path);
+}
+
+void GZDoomInstancer::duplicate_instance() {
+	const path og_instance_path = available_instance_paths[current_instance_index];
+	const path new_instance_path = rootdir / "instances" / new_instance_name;
+	std::filesystem::copy(og_instance_path, new_instance_path,
+			std::filesystem::copy_options::recursive);
+}
+
+void GZDoomInstancer::manager_launcher_view() {
+	ImVec2 size = ImGui::GetContentRegionAvail();
+	size.y -= ImGui::GetTextLineHeightWithSpacing();
+
+	ImGui::BeginTable("##0", 2, ImGuiTableFlags_BordersInnerV |
+			ImGuiTableFlags_RowBg |
+			ImGuiTableFlags_Hideable | ImGuiTableFlags_Reorderable,
+			size);
+	ImGui::TableSetupColumn("Instance Manager");
+	ImGui::TableSetupColumn("Game Launcher");
+	ImGui::TableHeadersRow();
+
+	ImGui::TableNextColumn();
+
+	ImGui::ListBox("Instances", &current_instance_index,
+			this->path_string_getter,
+			available_instance_paths.data(), available_instance_paths.size());
+	if (ImGui::Button("Refresh"))
+		available_instance_paths = list_instances();
+	if (!usage.ready) ImGui::Text("Disk Usage: scanning...");
+	else {
+		ImGui::Text("Disk Usage: instances %s, PWADs %s, IWADs %s",
+				format_size(usage.instances_bytes).c_str(),
+				format_size(usage.pwads_bytes).c_str(),
+				format_size(usage.iwads_bytes).c_str());
+		if (current_instance_index < available_instance_paths.size()) {
+			auto find = usage.instances.find(
+					available_instance_paths[current_instance_index]);
+			if (find != usage.instances.end())
+				ImGui::Text("Selected: own %s, exclusive pool %s, shared pool %s",
+						format_size(find->second.own_bytes).c_str(),
+						format_size(find->second.exclusive_bytes).c_str(),
+						format_size(find->second.shared_bytes).c_str());
+		}
+	}
+	if (current_instance_index != last_instance_index) {
+		path selected_instance_path = 
+			available_instance_paths[current_instance_index];
+		std::ptrdiff_t offset = selected_instance_path.string().length() -
+			selected_instance_path.filename().string().length();
+		memset(new_instance_name, 0, 32ul); 
+		strncpy(new_instance_name, selected_instance_path.c_str() + offset,
+				std::min(selected_instance_path.filename().string().length(), 31ul));
+		last_instance_index = current_instance_index;
+	}
+	ImGui::InputText("New Name", new_instance_name, 31ul);
+	if (ImGui::Button("Duplicate")) {
+		path new_instance_path = rootdir / "instances" / new_instance_name;
+		if (!std::filesystem::exists(new_instance_path)) {
+			duplicate_instance();
+			available_instance_paths = list_instances();
+			int new_instance_index = std::distance(available_instance_paths.begin(),
+					std::find(available_instance_paths.begin(),
+					available_instance_paths.end(),
+					new_instance_path));
+			if (new_instance_index < available_instance_paths.size())
+				current_instance_index = new_instance_index;
+		} else {
+			pfd::message message("ERROR!", "An instance already exists with this " \
+					"name. Aborting creation of new instance.", pfd::choice::ok,
+					pfd::icon::error);
+			message.ready();
+		}
+	}
+	if (ImGui::Button("New")) {
+		path new_instance_path = rootdir / "instances" / new_instance_name;
+		if (!std::filesystem::exists(new_instance_path)) {
+			iwad_path = "";
+			pwad_paths.clear();
+			save_instance();
+			available_instance_paths = list_instances();
+			int new_instance_index = std::distance(available_instance_paths.begin(),
+					std::find(available_instance_paths.begin(),
+					available_instance_paths.end(),
+					new_instance_path));
+			if (new_instance_index < available_instance_paths.size())
+				current_instance_index = new_instance_index;
+		} else {
+			pfd::message message("ERROR!", "An instance already exists with this " \
+					"name. Aborting creation of new instance.", pfd::choice::ok,
+					pfd::icon::error);
+			message.ready();
+		}
+	}
+	if (ImGui::Button("Delete")) {
+		delete_instance();
+		available_instance_paths = list_instances();
+	}
+	if (ImGui::Button("Edit")) {
+		load_instance();
+		current_view = EDITOR_VIEW;
+	}
+
+	archive_view();
+	save_browser_view();
+
+	ImGui::TableNextColumn();
+
+	ImGui::Checkbox("Close Instancer on Launch", &close_on_launch);
+	std::string button_name = std::string("Launch ") +
+		available_instance_paths[current_instance_index].filename().string();
+	if (ImGui::Button("Set GZDoom Path"))
+		gzdoom_path = gzdoom_dialog();
+	ImGui::TextWrapped("GZDoom Path: %s",
+			gzdoom_path.empty() ? "<unset>" : gzdoom_path.c_str());
+	if (ImGui::Button(button_name.c_str()))
+		launch_doom();
+	if (ImGui::Button("Demo Benchmark"))
+		current_view = BENCHMARK_VIEW;
+	ImGui::SameLine();
+	if (ImGui::Button("Metrics"))
+		current_view = METRICS_VIEW;
+
+	ImGui::EndTable();
+
+	ImGui::Text("%s", signature());
+}
+
+void GZDoomInstancer::editor_view() {
+	ImVec2 size = ImGui::GetContentRegionAvail();
+	size.y -= ImGui::GetTextLineHeightWithSpacing();
+
+	ImGui::BeginTable("##1", 1, ImGuiTableFlags_BordersInnerV |
+			ImGuiTableFlags_RowBg |
+			ImGuiTableFlags_Hideable | ImGuiTableFlags_Reorderable,
+			size);
+	std::string name = std::string("Editing instance " +
+			available_instance_paths[current_instance_index].filename().string());
+	ImGui::TableSetupColumn(name.c_str());
+	ImGui::TableHeadersRow();
+
+	ImGui::TableNextColumn();
+
+	if (ImGui::InputTextWithHint("##PWAD Filter", "Filter PWADs", pwad_filter,
+			sizeof(pwad_filter)))
+		filter_pwads();
+	ImGui::SameLine();
+	if (ImGui::Button("Select All Matching")) pwad_selection.select_all(visible_pwads);
+	ImGui::SameLine();
+	if (ImGui::Button("Clear Selection")) pwad_selection.clear();
+	ImGui::SameLine();
+	ImGui::Text("%zu of %zu selected", pwad_selection.size(), available_pwad_paths.size());
+
+	if (ImGui::BeginTable("PWADs", 3, ImGuiTableFlags_SizingFixedFit |
+			ImGuiTableFlags_BordersH | ImGuiTableFlags_BordersV |
+			ImGuiTableFlags_ScrollY,
+			ImVec2(0, ImGui::GetTextLineHeightWithSpacing() * 16))) {
+		// Only the rows in view are laid out, however big the pool.
+		ImGuiListClipper clipper;
+		clipper.Begin(visible_pwads.size());
+		while (clipper.Step()) {
+			for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+				const std::size_t i = visible_pwads[row];
+				const path& pwad = available_pwad_paths[i];
+				ImGui::PushID((int)i);
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				if (ImGui::Selectable(pwad.filename().c_str(), pwad_selection.contains(i),
+						ImGuiSelectableFlags_SpanAllColumns |
+						ImGuiSelectableFlags_AllowOverlap))
+					pwad_selection.click(visible_pwads, row,
+							ImGui::GetIO().KeyCtrl, ImGui::GetIO().KeyShift);
+				if (ImGui::IsItemHovered() && ImGui::BeginTooltip()) {
+					map_thumbnails_view(pwad);
+					ImGui::EndTooltip();
+				}
+				if (pwad_paths.contains(pwad)) {
+					ImGui::SameLine();
+					ImGui::TextDisabled("(active)");
+				}
+				if (!pool->writable(pwad)) {
+					ImGui::SameLine();
+					ImGui::TextDisabled("(shared)");
+				}
+				ImGui::TableSetColumnIndex(1);
+				auto size = usage.pool_files.find(pwad.string());
+				if (!pool->writable(pwad)) {
+					// DiskUsage only walks rootdir; shared layers are someone
+					// else's disk.
+					ImGui::TextDisabled("not counted");
+					if (ImGui::IsItemHovered() && ImGui::BeginTooltip()) {
+						ImGui::Text("Shared pool files live outside %s and aren't " \
+								"part of the disk usage totals.", rootdir.c_str());
+						ImGui::EndTooltip();
+					}
+				} else if (size != usage.pool_files.end()) {
+					auto refs = usage.pool_refs.find(size->first);
+					std::size_t ref_count = refs == usage.pool_refs.end() ? 0 : refs->second;
+					ImGui::Text("%s (%zu instances)", format_size(size->second).c_str(),
+							ref_count);
+				}
+				ImGui::TableSetColumnIndex(2);
+				bool selected = pwad_selection.contains(i);
+				if (ImGui::Checkbox("##selected", &selected)) pwad_selection.set(i, selected);
+				ImGui::PopID();
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button("Refresh PWAD List")) {
+		pool->invalidate();
+		refresh_available_pwads();
+	}
+	if (ImGui::Button("Add PWAD")) {
+		add_pwad();
+		refresh_available_pwads();
+	}
+	if (ImGui::Button("Delete Selected PWADs")) {
+		pfd::message message("WARNING!",
+				"Really delete selected PWADs? This is not reversible!",
+				pfd::choice::ok_cancel, pfd::icon::warning);
+		if (message.result() == pfd::button::ok) {
+			for (const path& pwad : selected_pwads()) {
+				// Shared pools are read-only; only the user's own copies go.
+				if (!pool->writable(pwad)) continue;
+				std::filesystem::remove(pwad);
+			}
+		}
+		refresh_available_pwads();
+	}
+	if (ImGui::Button("Activate Selected PWADs")) {
+		TRACE_SCOPE("editor.activate_pwads");
+		pwad_paths.activate(selected_pwads());
+	}
+	if (ImGui::Button("Deactivate Selected PWADs")) {
+		TRACE_SCOPE("editor.deactivate_pwads");
+		pwad_paths.deactivate(selected_pwads());
+	}
+
+	ImGui::NewLine();
+
+	if (ImGui::Button("IDGames Downloader")) {
+		current_view = IDGAMES_VIEW;
+		pinged_api_recently = false;
+	}
+
+	ImGui::NewLine();
+
+	ImGui::Text("Active PWADs:");
+	for (path pwad_path : pwad_paths) {
+		std::ptrdiff_t pwad_offset = pwad_path.string().length() -
+			pwad_path.filename().string().length();
+		ImGui::Text("\t%s", pwad_path.c_str() + pwad_offset);
+	}
+
+	lump_overrides_view();
+
+	ImGui::NewLine();
+
+	ImGui::ListBox("IWAD List", &current_iwad_index, path_string_getter,
+			available_iwad_paths.data(), available_iwad_paths.size());
+	if (ImGui::Button("Refresh IWAD List")) {
+		pool->invalidate();
+		available_iwad_paths = list_iwads();
+	}
+	if (ImGui::Button("Add IWAD")) {
+		add_iwad();
+		available_iwad_paths = list_iwads();
+	}
+	if (ImGui::Button("Activate Selected IWAD")) {
+		iwad_path = available_iwad_paths[current_iwad_index];
+		available_iwad_paths = list_iwads();
+	}
+
+	ImGui::NewLine();
+
+	std::ptrdiff_t iwad_offset = iwad_path.string().length() -
+		iwad_path.filename().string().length();
+	ImGui::Text("Active IWAD: %s",
+			iwad_path.empty() ? "<unset>" : iwad_path.c_str() + iwad_offset);
+
+	auto instance_usage = usage.instances.find(
+			available_instance_paths[current_instance_index]);
+	if (instance_usage != usage.instances.end())
+		ImGui::Text("Instance Size: own %s, exclusive pool %s, shared pool %s",
+				format_size(instance_usage->second.own_bytes).c_str(),
+				format_size(instance_usage->second.exclusive_bytes).c_str(),
+				format_size(instance_usage->second.shared_bytes).c_str());
+
+	ImGui::NewLine();
+	
+	if (ImGui::Button("OK")) {
+		path target_instance = available_instance_paths[current_instance_index]; 
+		memset(new_instance_name, 0, sizeof(new_instance_name));
+		std::size_t length = target_instance.string().length() -
+			target_instance.filename().string().length();
+		strncpy(new_instance_name,
+				available_instance_paths[current_instance_index].c_str() + length,
+				target_instance.filename().string().length());
+		save_instance();
+		available_instance_paths = list_instances();
+		current_view = MANAGER_LAUNCHER_VIEW;
+	}
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Apply")) {
+		path target_instance = available_instance_paths[current_instance_index]; 
+		memset(new_instance_name, 0, sizeof(new_instance_name));
+		std::size_t length = target_instance.string().length() -
+			target_instance.filename().string().length();
+		strncpy(new_instance_name,
+				available_instance_paths[current_instance_index].c_str() + length,
+				target_instance.filename().string().length());
+		save_instance();
+		available_instance_paths = list_instances();
+	}
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Cancel")) current_view = MANAGER_LAUNCHER_VIEW;
+
+	ImGui::EndTable();
+
+	ImGui::Text("%s", signature());
+}
+
+void GZDoomInstancer::archive_view() {
+	if (archive_job.valid()) {
+		const std::uintmax_t total = archive_progress.total_bytes;
+		ImGui::ProgressBar(total ? (float)archive_progress.done_bytes / total : 0.0f,
+				ImVec2(-FLT_MIN, 0), archive_job_name.c_str());
+		if (archive_job.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			archive_status = archive_job.get();
+			available_instance_paths = list_instances();
+		}
+		return;
+	}
+
+	ImGui::Checkbox("Include IWAD/PWAD Files", &export_include_pool);
+	if (ImGui::Button("Export") &&
+			current_instance_index < available_instance_paths.size()) {
+		const path instance_path = available_instance_paths[current_instance_index];
+		pfd::save_file file_selector("Export Instance",
+				instance_path.filename().string() + ".zip",
+				{"Instance Archives", "*.zip"}, pfd::opt::none);
+		const path archive = file_selector.result();
+		if (!archive.empty()) {
+			archive_progress.done_bytes = 0;
+			archive_progress.total_bytes = 0;
+			archive_job_name = "Exporting " + instance_path.filename().string();
+			archive_job = std::async(std::launch::async,
+					[this, instance_path, archive, include = export_include_pool]() {
+				export_result_t result = export_instance(rootdir, instance_path, archive,
+						include, file_hashes, &archive_progress);
+				if (!result.ok) return "Export failed: " + result.error;
+				return "Exported " + format_size(result.input_bytes) + " as " +
+					format_size(result.output_bytes) + " in " +
+					std::to_string(result.seconds) + "s (" +
+					format_size(result.input_bytes / std::max(result.seconds, 0.001)) +
+					"/s)";
+			});
+		}
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Import")) {
+		pfd::open_file file_selector("Import Instance", ".",
+				{"Instance Archives", "*.zip"}, pfd::opt::none);
+		const std::vector<std::string> result = file_selector.result();
+		if (!result.empty()) {
+			const path archive = result[0];
+			archive_progress.done_bytes = 0;
+			archive_progress.total_bytes = 0;
+			archive_job_name = "Importing " + archive.filename().string();
+			archive_job = std::async(std::launch::async, [this, archive]() {
+				import_result_t result = import_instance(rootdir, archive, file_hashes,
+						&archive_progress, pool);
+				if (!result.ok) return "Import failed: " + result.error;
+				return "Imported " + result.instance_name + " (" +
+					std::to_string(result.pool_files_written) + " pool files added, " +
+					std::to_string(result.pool_files_skipped) + " already present, " +
+					std::to_string(result.pool_files_missing) + " missing)";
+			});
+		}
+	}
+	if (!archive_status.empty()) ImGui::TextWrapped("%s", archive_status.c_str());
+}
+
+void GZDoomInstancer::save_browser_view() {
+	if (!ImGui::CollapsingHeader("Saves")) return;
+	if (current_instance_index >= available_instance_paths.size()) return;
+	const path& instance_path = available_instance_paths[current_instance_index];
+	if (save_browser.instance() != instance_path) save_browser.open(instance_path);
+	else save_browser.refresh();
+
+	const float row_height = SAVE_THUMBNAIL_HEIGHT;
+	if (!ImGui::BeginTable("Saves", 4, ImGuiTableFlags_BordersH |
+			ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+			ImVec2(0, row_height * 6))) return;
+	ImGui::TableSetupScrollFreeze(0, 1);
+	ImGui::TableSetupColumn("Screenshot", ImGuiTableColumnFlags_WidthFixed,
+			row_height * 4 / 3);
+	ImGui::TableSetupColumn("Title");
+	ImGui::TableSetupColumn("Map");
+	ImGui::TableSetupColumn("Saved");
+	ImGui::TableHeadersRow();
+
+	ImGuiListClipper clipper;
+	clipper.Begin(save_browser.size(), row_height);
+	while (clipper.Step()) {
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+			const SaveBrowser::row_t row = save_browser.row(i);
+			ImGui::TableNextRow(ImGuiTableRowFlags_None, row_height);
+			ImGui::TableSetColumnIndex(0);
+			if (row.texture)
+				ImGui::Image((ImTextureID)(intptr_t)row.texture,
+						ImVec2(row_height * row.thumb_width / row.thumb_height,
+						row_height));
+			ImGui::TableSetColumnIndex(1);
+			ImGui::TextWrapped("%s", row.indexed ? row.title.c_str() : row.name.c_str());
+			ImGui::TableSetColumnIndex(2);
+			ImGui::Text("%s", row.indexed ? row.map.c_str() : "...");
+			ImGui::TableSetColumnIndex(3);
+			ImGui::Text("%s", row.indexed ? row.time.c_str() : "...");
+		}
+	}
+	ImGui::EndTable();
+}
+
+void GZDoomInstancer::map_thumbnails_view(const path& file) {
+	ThumbnailCache::atlas_t* atlas = thumbnails->request(file);
+	if (!atlas) {
+		ImGui::Text("Rendering map previews...");
+		return;
+	}
+	if (atlas->maps.empty()) {
+		ImGui::Text("No maps in %s", file.filename().c_str());
+		return;
+	}
+
+	const ImVec2 size(THUMBNAIL_DISPLAY_SIZE, THUMBNAIL_DISPLAY_SIZE);
+	const int columns = 6;
+	for (std::size_t i = 0; i < atlas->maps.size(); i++) {
+		if (i % columns != 0) ImGui::SameLine();
+		ImGui::BeginGroup();
+		if (ImGui::IsRectVisible(size)) {
+			const ImVec2 uv0((float)(i % atlas->columns) / atlas->columns,
+					(float)(i / atlas->columns) / atlas->rows);
+			const ImVec2 uv1(uv0.x + 1.0f / atlas->columns, uv0.y + 1.0f / atlas->rows);
+			ImGui::Image((ImTextureID)(intptr_t)thumbnails->texture(atlas), size, uv0, uv1);
+		} else ImGui::Dummy(size);
+		ImGui::Text("%s", atlas->maps[i].c_str());
+		ImGui::EndGroup();
+	}
+}
+
+void GZDoomInstancer::lump_overrides_view() {
+	if (pwad_paths.generation() != analyzed_generation || iwad_path != analyzed_iwad) {
+		std::vector<path> load_order{};
+		if (!iwad_path.empty()) load_order.push_back(iwad_path);
+		load_order.insert(load_order.end(), pwad_paths.begin(), pwad_paths.end());
+		if (load_order != analyzed_load_order) {
+			lump_analyzer.analyze(load_order);
+			analyzed_load_order = load_order;
+		}
+		analyzed_generation = pwad_paths.generation();
+		analyzed_iwad = iwad_path;
+	}
+	lump_analyzer.poll();
+
+	if (!ImGui::CollapsingHeader("Lump Overrides")) return;
+	const LumpAnalyzer::result_t& result = lump_analyzer.result();
+	ImGui::Text("%zu lumps, %zu overridden (%.0f ms)%s", result.total_lumps,
+			result.conflicts, result.seconds * 1000.0,
+			lump_analyzer.busy() ? " - analysing..." : "");
+	for (std::size_t i = 0; i < result.files.size(); i++) {
+		const LumpAnalyzer::file_t& file = result.files[i];
+		std::string label = file.file.filename().string() + " (" +
+			std::to_string(file.lumps) + " lumps, " +
+			std::to_string(file.overrides.size()) + " overrides)" +
+			(file.readable ? "" : " <unreadable>") + "##lumps" + std::to_string(i);
+		if (!ImGui::TreeNode(label.c_str())) continue;
+		ImGuiListClipper clipper;
+		clipper.Begin(file.overrides.size());
+		while (clipper.Step()) {
+			for (int j = clipper.DisplayStart; j < clipper.DisplayEnd; j++) {
+				const LumpAnalyzer::override_t& replaced = file.overrides[j];
+				ImGui::Text("%s (replaces %s)", replaced.key.c_str(),
+						result.files[replaced.overridden].file.filename().c_str());
+			}
+		}
+		ImGui::TreePop();
+	}
+}
+
+void GZDoomInstancer::mirrors_section() {
+	if (!ImGui::CollapsingHeader("Mirrors")) return;
+	if (ImGui::Button("Probe Now")) mirrors->probe_soon();
+	ImGui::SameLine();
+	ImGui::TextWrapped(mirrors->racing() ?
+			"Downloads race the top two mirrors." : "Downloads use the top mirror.");
+	const std::time_t now = std::time(nullptr);
+	if (!ImGui::BeginTable("Mirrors", 4, ImGuiTableFlags_BordersH |
+			ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) return;
+	for (const char* column : {"Mirror", "Latency", "Throughput", "Status"})
+		ImGui::TableSetupColumn(column);
+	ImGui::TableHeadersRow();
+	for (const MirrorSet::mirror_t& mirror : mirrors->ranked()) {
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::Text("%s", mirror.url.c_str());
+		ImGui::TableNextColumn();
+		if (mirror.latency_ms > 0) ImGui::Text("%.0fms", mirror.latency_ms);
+		else ImGui::TextDisabled("-");
+		ImGui::TableNextColumn();
+		if (mirror.throughput_bps > 0)
+			ImGui::Text("%s/s", format_size((std::uintmax_t)mirror.throughput_bps).c_str());
+		else ImGui::TextDisabled("-");
+		ImGui::TableNextColumn();
+		if (mirror.retry_after > now)
+			ImGui::Text("Down, retry in %llds", (long long)(mirror.retry_after - now));
+		else if (mirror.last_probe == 0) ImGui::TextDisabled("Not probed");
+		else ImGui::Text("OK");
+	}
+	ImGui::EndTable();
+}
+
+void GZDoomInstancer::idgames_view() {
+	if (!pinged_api_recently) {
+		api_ping_result = iga_ping();
+		pinged_api_recently = true;
+	}
+	ImVec2 size = ImGui::GetContentRegionAvail();
+	size.y -= ImGui::GetTextLineHeightWithSpacing();
+
+	ImGui::BeginTable("##2", 1, ImGuiTableFlags_BordersInnerV |
+			ImGuiTableFlags_RowBg |
+			ImGuiTableFlags_Hideable | ImGuiTableFlags_Reorderable,
+			size);
+	ImGui::TableSetupColumn("IDGames Download");
+	ImGui::TableHeadersRow();
+
+	ImGui::TableNextColumn();
+
+	if (api_ping_result && pinged_api_recently) {
+		if (!obtained_files) {
+			current_idgames_index = 0;
+			current_idgames_path = "";
+			available_idgames_paths = {};
+			for (path idgames_path : iga_getdirs())
+				available_idgames_paths.push_back(idgames_path);
+			for (path idgames_path : iga_getfiles())
+				available_idgames_paths.push_back(idgames_path);
+			obtained_files = true;
+		}
+		ImGui::ListBox("Files", &current_idgames_index, path_string_getter,
+				available_idgames_paths.data(), available_idgames_paths.size());
+		if (current_idgames_index != previous_idgames_index) {
+			if (!available_idgames_paths[current_idgames_index].filename().empty())
+				current_idgames_details =
+					iga_getdetails(available_idgames_paths[current_idgames_index]);
+			else current_idgames_details.discovered = false;
+			previous_idgames_index = current_idgames_index;
+		}
+		if (current_idgames_details.discovered)
+			ImGui::TextWrapped("Name: %s\nFilename: %s\nID: %zu\n" \
+					"Description: %s\nRating:%u/5 (%u votes)",
+					current_idgames_details.name.c_str(),
+					current_idgames_details.filename.c_str(),
+					current_idgames_details.id,
+					current_idgames_details.description.c_str(),
+					current_idgames_details.rating,
+					current_idgames_details.votes);
+		if (ImGui::Button("Select")) {
+			if (available_idgames_paths.size() > current_idgames_index &&
+					available_idgames_paths[current_idgames_index].filename().empty()) {
+				if (available_idgames_paths[current_idgames_index] == "../") {
+					current_idgames_path =
+						current_idgames_path.parent_path().parent_path();
+					if (!current_idgames_path.empty()) current_idgames_path += "/";
+				} else current_idgames_path =
+						available_idgames_paths[current_idgames_index];
+				available_idgames_paths.clear();
+				if (!current_idgames_path.empty())
+					available_idgames_paths.push_back("../");
+				for (path idgames_path : iga_getdirs())
+					available_idgames_paths.push_back(idgames_path);
+				for (path idgames_path : iga_getfiles()) {
+					available_idgames_paths.push_back(idgames_path);
+				}
+			} else {
+				iga_downloadfile(available_idgames_paths[current_idgames_index]);
+				refresh_available_pwads();
+			}
+			current_idgames_index = 0;
+		}
+	} else ImGui::TextWrapped("Failed to connect to Doomworld IDGames API." \
+				"Check your network settings or try again later.");
+
+	mirrors_section();
+
+	if (ImGui::Button("Return")) current_view = EDITOR_VIEW;
+
+	ImGui::EndTable();
+}
+
+void GZDoomInstancer::benchmark_view() {
+	ImVec2 size = ImGui::GetContentRegionAvail();
+	size.y -= ImGui::GetTextLineHeightWithSpacing();
+
+	ImGui::BeginTable("##3", 1, ImGuiTableFlags_BordersInnerV |
+			ImGuiTableFlags_RowBg |
+			ImGuiTableFlags_Hideable | ImGuiTableFlags_Reorderable,
+			size);
+	ImGui::TableSetupColumn("Demo Benchmark");
+	ImGui::TableHeadersRow();
+
+	ImGui::TableNextColumn();
+
+	if (benchmark_instances.size() != available_instance_paths.size())
+		benchmark_instances.assign(available_instance_paths.size(), false);
+	ImGui::Text("Instances:");
+	for (std::size_t i = 0; i < available_instance_paths.size(); i++) {
+		std::string label = available_instance_paths[i].filename().string() +
+			"##bench" + std::to_string(i);
+		bool selected = benchmark_instances[i];
+		if (ImGui::Checkbox(label.c_str(), &selected)) benchmark_instances[i] = selected;
+	}
+	ImGui::InputText("Demo", benchmark_demo, sizeof(benchmark_demo));
+	ImGui::InputText("Extra Arguments", benchmark_args, sizeof(benchmark_args));
+	ImGui::SliderInt("Repeats", &benchmark_repeats, 1, 10);
+	ImGui::SliderInt("Parallel Runs", &benchmark_parallel, 1,
+			std::max(1u, std::thread::hardware_concurrency()));
+
+	if (demo_benchmark->running()) {
+		ImGui::Text("Running...");
+		ImGui::SameLine();
+		if (ImGui::Button("Cancel")) demo_benchmark->cancel();
+	} else {
+		if (ImGui::Button("Run")) {
+			DemoBenchmark::job_t job{
+				.gzdoom_path = gzdoom_path,
+				.demo = benchmark_demo,
+				.extra_args = benchmark_args,
+				.repeats = benchmark_repeats,
+				.parallel = benchmark_parallel,
+				.pool = pool
+			};
+			for (std::size_t i = 0; i < available_instance_paths.size(); i++)
+				if (benchmark_instances[i])
+					job.instances.push_back(available_instance_paths[i]);
+			if (job.instances.empty() || !std::filesystem::exists(gzdoom_path) ||
+					benchmark_demo[0] == '\0') {
+				pfd::message message("ERROR!", "Pick at least one instance and a demo, " \
+						"and set the GZDoom path.", pfd::choice::ok, pfd::icon::error);
+				message.ready();
+			} else demo_benchmark->start(job);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear Results")) demo_benchmark->clear();
+	}
+
+	const std::vector<DemoBenchmark::run_t> runs = demo_benchmark->results();
+	if (ImGui::BeginTable("Results", 8, ImGuiTableFlags_BordersH |
+			ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+			ImGuiTableFlags_SizingFixedFit,
+			ImVec2(0, ImGui::GetContentRegionAvail().y -
+			ImGui::GetFrameHeightWithSpacing()))) {
+		ImGui::TableSetupScrollFreeze(0, 1);
+		for (const char* column : {"Instance", "Demo", "Run", "FPS", "Gametics",
+				"Realtics", "Wall Time", "Started"})
+			ImGui::TableSetupColumn(column);
+		ImGui::TableHeadersRow();
+		ImGuiListClipper clipper;
+		clipper.Begin(runs.size());
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+				const DemoBenchmark::run_t& run = runs[i];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", path(run.instance).filename().c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", run.demo.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", run.repeat);
+				ImGui::TableNextColumn();
+				if (!run.finished) ImGui::Text("...");
+				else if (!run.ok) ImGui::Text("failed (%d)", run.exit_code);
+				else ImGui::Text("%.1f", run.fps);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)run.gametics);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)run.realtics);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2fs", run.wall_seconds);
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", run.started.c_str());
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button("Return")) current_view = MANAGER_LAUNCHER_VIEW;
+
+	ImGui::EndTable();
+}
+
+void GZDoomInstancer::metrics_view() {
+	ImVec2 size = ImGui::GetContentRegionAvail();
+	size.y -= ImGui::GetTextLineHeightWithSpacing();
+
+	ImGui::BeginTable("##4", 1, ImGuiTableFlags_BordersInnerV |
+			ImGuiTableFlags_RowBg |
+			ImGuiTableFlags_Hideable | ImGuiTableFlags_Reorderable,
+			size);
+	ImGui::TableSetupColumn("Metrics");
+	ImGui::TableHeadersRow();
+
+	ImGui::TableNextColumn();
+
+	bool tracing = trace::enabled;
+	if (ImGui::Checkbox("Record Traces", &tracing)) trace::set_enabled(tracing);
+	ImGui::SameLine();
+	if (ImGui::Button("Clear")) trace::clear();
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome Trace")) {
+		char timestr[64];
+		std::time_t now = std::time(nullptr);
+		std::strftime(timestr, sizeof(timestr), "%d-%m-%Y-%T", std::localtime(&now));
+		const path trace_file = rootdir / "traces" / (std::string(timestr) + ".json");
+		if (trace::export_chrome(trace_file)) metrics_status = "Wrote " + trace_file.string();
+		else metrics_status = "Couldn't write " + trace_file.string();
+	}
+	ImGui::Text("%zu events buffered. %s", trace::event_count(), metrics_status.c_str());
+
+	for (int i = 0; i < trace::COUNTER_COUNT; i++) {
+		const std::uint64_t value = trace::counters[i];
+		if (i == trace::BYTES_DOWNLOADED || i == trace::ALLOCATED_BYTES)
+			ImGui::Text("%s: %s", trace::counter_name((trace::counter_t)i),
+					format_size(value).c_str());
+		else ImGui::Text("%s: %llu", trace::counter_name((trace::counter_t)i),
+				(unsigned long long)value);
+	}
+
+	const std::vector<trace::operation_t> operations = trace::operations();
+	if (ImGui::BeginTable("Operations", 6, ImGuiTableFlags_BordersH |
+			ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+			ImGuiTableFlags_SizingFixedFit,
+			ImVec2(0, ImGui::GetContentRegionAvail().y -
+			ImGui::GetFrameHeightWithSpacing()))) {
+		ImGui::TableSetupScrollFreeze(0, 1);
+		for (const char* column : {"Operation", "Count", "p50", "p99", "Max", "Total"})
+			ImGui::TableSetupColumn(column);
+		ImGui::TableHeadersRow();
+		for (const trace::operation_t& operation : operations) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", operation.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)operation.count);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3fms", operation.p50_ms);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3fms", operation.p99_ms);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3fms", operation.max_ms);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1fms", operation.total_ms);
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button("Return")) current_view = MANAGER_LAUNCHER_VIEW;
+
+	ImGui::EndTable();
+}
+
+void GZDoomInstancer::process() {
+	TRACE_SCOPE("frame.process");
+	if (disk_usage->generation() != usage.generation)
+		usage = disk_usage->snapshot();
+
+	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
+	ImGui::SetNextWindowPos(ImVec2{0,0});
+	ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+	ImGui::Begin("MainWindow", NULL, 
+			ImGuiWindowFlags_NoDecoration |
+			ImGuiWindowFlags_NoResize);
+
+	switch (current_view) {
+	case MANAGER_LAUNCHER_VIEW:
+		manager_launcher_view();
+		break;
+	case EDITOR_VIEW:
+		editor_view();
+		break;
+	case IDGAMES_VIEW:
+		idgames_view();
+		break;
+	case BENCHMARK_VIEW:
+		benchmark_view();
+		break;
+	case METRICS_VIEW:
+		metrics_view();
+		break;
+	default:
+		ImGui::TextWrapped("\"You picked a bad time to get lost, friend!\"");
+		ImGui::TextWrapped("You shouldn't be here. "\
+				"You should tell someone about this and what you did to end up here.");
+		ImGui::TextWrapped("Also, you can press the button below to go back home.");
+		if (ImGui::Button("Return")) current_view = MANAGER_LAUNCHER_VIEW;
+		break;
+	}
+
+	ImGui::End();
+	ImGui::PopStyleVar(1);
+
+	save_browser.end_frame();
+}
+
+CURLcode GZDoomInstancer::iga_perform(CURL* curl) {
+	TRACE_SCOPE("net.curl_easy_perform");
+	CURLcode res = curl_easy_perform(curl);
+	curl_off_t downloaded = 0;
+	if (curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded) == CURLE_OK)
+		trace::count(trace::BYTES_DOWNLOADED, downloaded);
+	return res;
+}
+
+void GZDoomInstancer::iga_prepare_curl(const char* url, CURL* curl, memory_chunk** chunk) {
+	*chunk = new memory_chunk{
+		.data = (char*)malloc(1),
+		.size = 0
+	};
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+	curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_MAX_TLSv1_2);
+
+	curl_easy_setopt(curl, CURLOPT_USERAGENT,
+		"GZDoomInstancer/0.3 (https://www.github.com/timerunner16)");
+
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_memory_cb);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)*chunk);
+}
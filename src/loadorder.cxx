@@ -0,0 +1,44 @@
+#include "loadorder.h"
+
+void LoadOrder::assign(const std::vector<path>& paths) {
+	order.clear();
+	index.clear();
+	index.reserve(paths.size());
+	for (const path& pwad : paths) {
+		// A config listing a file twice only loads it once.
+		if (index.contains(pwad.string())) continue;
+		index[pwad.string()] = order.insert(order.end(), pwad);
+	}
+	changes++;
+}
+
+void LoadOrder::clear() {
+	order.clear();
+	index.clear();
+	changes++;
+}
+
+std::size_t LoadOrder::activate(const std::vector<path>& pwads) {
+	std::size_t added = 0;
+	for (const path& pwad : pwads) {
+		auto [entry, inserted] = index.try_emplace(pwad.string());
+		if (!inserted) continue;
+		entry->second = order.insert(order.end(), pwad);
+		added++;
+	}
+	if (added) changes++;
+	return added;
+}
+
+std::size_t LoadOrder::deactivate(const std::vector<path>& pwads) {
+	std::size_t removed = 0;
+	for (const path& pwad : pwads) {
+		auto entry = index.find(pwad.string());
+		if (entry == index.end()) continue;
+		order.erase(entry->second);
+		index.erase(entry);
+		removed++;
+	}
+	if (removed) changes++;
+	return removed;
+}
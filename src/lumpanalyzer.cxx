@@ -0,0 +1,221 @@
+#include "lumpanalyzer.h"
+#include "wad.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+// Lumps every loaded file contributes to instead of replacing.
+static bool is_cumulative_lump(const std::string& name) {
+	static const char* cumulative[] = {
+		"DECORATE", "ZSCRIPT", "MAPINFO", "ZMAPINFO", "UMAPINFO", "SNDINFO",
+		"SNDSEQ", "KEYCONF", "GLDEFS", "TEXTURES", "LANGUAGE", "ANIMDEFS",
+		"LOCKDEFS", "DEHACKED", "CVARINFO", "MENUDEF", "TERRAIN", "DECALDEF",
+		"FONTDEFS", "MODELDEF", "VOXELDEF", "GAMEINFO", "LOADACS", "TEXTCOLO",
+		"ALTHUDCF", "SECRETS", "REVERBS", "EMAPINFO", "MUSINFO", "IWADINFO",
+	};
+	for (const char* lump : cumulative)
+		if (name == lump) return true;
+	return false;
+}
+
+static const char* wad_namespace(const std::string& marker) {
+	if (marker == "S_START" || marker == "SS_START") return "sprites";
+	if (marker == "F_START" || marker == "FF_START") return "flats";
+	if (marker == "P_START" || marker == "PP_START") return "patches";
+	if (marker == "TX_START") return "textures";
+	if (marker == "HI_START") return "hires";
+	if (marker == "C_START") return "colormaps";
+	if (marker == "A_START") return "acs";
+	if (marker == "V_START") return "voices";
+	if (marker == "VX_START") return "voxels";
+	return nullptr;
+}
+
+static std::string short_name(const path& entry) {
+	std::string name = entry.stem().string().substr(0, 8);
+	for (char& c : name) c = toupper(c);
+	return name;
+}
+
+// Maps a WAD directory onto the same keys a PK3 would produce, so a PK3
+// sprite replacing a WAD sprite shows up as an override.
+static void wad_keys(const std::vector<lump_t>& lumps, std::vector<std::string>& keys) {
+	const char* ns = nullptr;
+	for (std::size_t i = 0; i < lumps.size(); i++) {
+		const std::string& name = lumps[i].name;
+		if (i+1 < lumps.size() &&
+				(lumps[i+1].name == "THINGS" || lumps[i+1].name == "TEXTMAP")) {
+			keys.push_back("maps/" + name);
+			while (i+1 < lumps.size() && is_map_lump(lumps[i+1].name)) i++;
+			continue;
+		}
+		if (name.ends_with("_START")) {
+			if (const char* start = wad_namespace(name)) ns = start;
+			continue;
+		}
+		if (name.ends_with("_END")) {
+			if (wad_namespace(name.substr(0, name.size()-4) + "_START")) ns = nullptr;
+			continue;
+		}
+		if (lumps[i].size == 0) continue;
+		if (!ns && is_cumulative_lump(name)) continue;
+		keys.push_back(std::string(ns ? ns : "global") + "/" + name);
+	}
+}
+
+static void pk3_keys(const std::vector<std::string>& entries, std::vector<std::string>& keys) {
+	static const char* namespaces[] = {
+		"sprites", "flats", "patches", "textures", "hires", "colormaps",
+		"acs", "voices", "voxels",
+	};
+	for (const std::string& entry : entries) {
+		std::string lower = entry;
+		for (char& c : lower) c = tolower(c);
+		const path entry_path(lower);
+		const std::string top = entry_path.begin()->string();
+
+		if (std::next(entry_path.begin()) == entry_path.end() ||
+				top == "graphics" || top == "sounds" || top == "music") {
+			const std::string name = short_name(entry_path);
+			if (top == entry_path.filename().string() && is_cumulative_lump(name)) continue;
+			keys.push_back("global/" + name);
+			continue;
+		}
+		if (top == "maps" && entry_path.extension() == ".wad") {
+			keys.push_back("maps/" + short_name(entry_path));
+			continue;
+		}
+		if (std::find_if(std::begin(namespaces), std::end(namespaces),
+				[&](const char* ns) { return top == ns; }) != std::end(namespaces)) {
+			keys.push_back(top + "/" + short_name(entry_path));
+			continue;
+		}
+		keys.push_back("path/" + lower);
+	}
+}
+
+LumpAnalyzer::~LumpAnalyzer() {
+	if (job.valid()) job.wait();
+}
+
+void LumpAnalyzer::analyze(const std::vector<path>& load_order) {
+	if (job.valid()) {
+		pending = load_order;
+		has_pending = true;
+		return;
+	}
+	job = std::async(std::launch::async, &LumpAnalyzer::run, this, load_order);
+}
+
+bool LumpAnalyzer::poll() {
+	if (!job.valid()) return false;
+	if (job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+	last_result = job.get();
+	if (has_pending) {
+		has_pending = false;
+		job = std::async(std::launch::async, &LumpAnalyzer::run, this, std::move(pending));
+		pending = {};
+	}
+	return true;
+}
+
+LumpAnalyzer::directory_t LumpAnalyzer::read_directory(const path& file) {
+	directory_t directory{.readable = false};
+	std::error_code ec;
+	directory.mtime = std::filesystem::last_write_time(file, ec);
+	directory.size = std::filesystem::file_size(file, ec);
+
+	MappedFile mapped(file);
+	if (!mapped.valid()) return directory;
+	if (is_wad(mapped.data(), mapped.size())) {
+		std::vector<lump_t> lumps{};
+		if (!read_wad_directory(mapped.data(), mapped.size(), lumps)) return directory;
+		wad_keys(lumps, directory.keys);
+	} else {
+		std::vector<std::string> entries{};
+		if (!read_pk3_directory(mapped.data(), mapped.size(), entries)) return directory;
+		pk3_keys(entries, directory.keys);
+	}
+	std::sort(directory.keys.begin(), directory.keys.end());
+	directory.keys.erase(std::unique(directory.keys.begin(), directory.keys.end()),
+			directory.keys.end());
+	directory.readable = true;
+	return directory;
+}
+
+LumpAnalyzer::result_t LumpAnalyzer::run(std::vector<path> load_order) {
+	TRACE_SCOPE("lumps.analyze");
+	auto start = std::chrono::steady_clock::now();
+
+	// Only files that are new or changed on disk get reparsed.
+	std::vector<std::size_t> stale{};
+	{
+		std::lock_guard<std::mutex> guard(cache_lock);
+		for (std::size_t i = 0; i < load_order.size(); i++) {
+			auto cached = cache.find(load_order[i].string());
+			std::error_code ec;
+			if (cached != cache.end() &&
+					cached->second.mtime == std::filesystem::last_write_time(load_order[i], ec) &&
+					cached->second.size == std::filesystem::file_size(load_order[i], ec)) {
+				trace::count(trace::CACHE_HITS);
+				continue;
+			}
+			trace::count(trace::CACHE_MISSES);
+			stale.push_back(i);
+		}
+	}
+
+	std::atomic<std::size_t> next = 0;
+	auto worker = [&]() {
+		for (std::size_t i = next++; i < stale.size(); i = next++) {
+			const path& file = load_order[stale[i]];
+			TRACE_SCOPE("lumps.read_directory");
+			directory_t directory = read_directory(file);
+			std::lock_guard<std::mutex> guard(cache_lock);
+			cache[file.string()] = std::move(directory);
+		}
+	};
+	std::size_t thread_count = std::min<std::size_t>(stale.size(),
+			std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads{};
+	for (std::size_t i = 1; i < thread_count; i++) threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads) thread.join();
+
+	result_t result{.load_order = load_order, .total_lumps = 0, .conflicts = 0};
+	struct provider_t {
+		std::size_t last;
+		bool overridden;
+	};
+	std::unordered_map<std::string_view, provider_t> providers{};
+	std::lock_guard<std::mutex> guard(cache_lock);
+	for (const path& file : load_order)
+		result.total_lumps += cache[file.string()].keys.size();
+	providers.reserve(result.total_lumps);
+
+	for (std::size_t i = 0; i < load_order.size(); i++) {
+		const directory_t& directory = cache[load_order[i].string()];
+		file_t file{
+			.file = load_order[i],
+			.readable = directory.readable,
+			.lumps = directory.keys.size()
+		};
+		for (const std::string& key : directory.keys) {
+			auto [provider, inserted] = providers.try_emplace(key,
+					provider_t{.last = i, .overridden = false});
+			if (inserted) continue;
+			file.overrides.push_back({.key = key, .overridden = provider->second.last});
+			if (!provider->second.overridden) result.conflicts++;
+			provider->second = {.last = i, .overridden = true};
+		}
+		result.files.push_back(std::move(file));
+	}
+
+	result.seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+	return result;
+}
@@ -0,0 +1,516 @@
+#include "mirrors.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+using json=nlohmann::json;
+
+static const char* default_mirrors[] = {
+	"https://www.quaddicted.com/files/idgames",
+	"https://youfailit.net/pub/idgames",
+	"https://www.gamers.org/pub/idgames",
+	"https://ftpmirror1.infania.net/pub/idgames",
+};
+
+// Weight of a new sample in the running averages.
+static constexpr double smoothing = 0.4;
+// Mirrors are compared by how long this much data would take.
+static constexpr double reference_bytes = 4 << 20;
+// Guesses for mirrors that haven't been measured yet.
+static constexpr double unknown_latency_ms = 400;
+static constexpr double unknown_throughput_bps = 1 << 20;
+
+static const char* user_agent = "GZDoomInstancer/0.3 (https://www.github.com/timerunner16)";
+
+static std::string join_url(const std::string& base, const std::string& relative) {
+	std::string url = base;
+	while (url.ends_with("/")) url.pop_back();
+	std::size_t start = 0;
+	while (start < relative.size() && relative[start] == '/') start++;
+	return url + "/" + relative.substr(start);
+}
+
+MirrorSet::MirrorSet(const path& config_file) {
+	std::vector<std::string> urls{};
+	std::ifstream i(config_file);
+	if (i.is_open()) {
+		json j = json::parse(i, nullptr, false);
+		if (j.is_object()) {
+			if (j.contains("mirrors") && j["mirrors"].is_array())
+				for (const json& url : j["mirrors"])
+					if (url.is_string()) urls.push_back(url);
+			race = j.value("race", race);
+			probe_path = j.value("probe_path", probe_path);
+			probe_bytes = j.value("probe_bytes", probe_bytes);
+			probe_interval = std::max(10, j.value("probe_interval", probe_interval));
+			stall_timeout = std::max(1, j.value("stall_timeout", stall_timeout));
+			connect_timeout = std::max(1, j.value("connect_timeout", connect_timeout));
+		}
+	}
+	if (const char* env = getenv("DOOM_INSTANCER_MIRRORS")) {
+		urls.clear();
+		std::string list = env;
+		std::replace(list.begin(), list.end(), ',', ' ');
+		std::stringstream stream(list);
+		std::string url;
+		while (stream >> url) urls.push_back(url);
+	}
+	if (urls.empty()) urls.assign(std::begin(default_mirrors), std::end(default_mirrors));
+
+	for (const std::string& url : urls)
+		mirrors.push_back({
+			.url = url,
+			.latency_ms = 0,
+			.throughput_bps = 0,
+			.failures = 0,
+			.last_probe = 0,
+			.retry_after = 0
+		});
+}
+
+MirrorSet::~MirrorSet() {
+	stop();
+}
+
+void MirrorSet::start() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (running) return;
+	running = true;
+	stopping = false;
+	prober = std::thread(&MirrorSet::run, this);
+}
+
+void MirrorSet::stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running = false;
+		stopping = true;
+		if (probing) curl_multi_wakeup((CURLM*)probing);
+	}
+	wake.notify_all();
+	if (prober.joinable()) prober.join();
+}
+
+void MirrorSet::probe_soon() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		probe_requested = true;
+	}
+	wake.notify_all();
+}
+
+void MirrorSet::run() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (running) {
+		probe_requested = false;
+		guard.unlock();
+		probe();
+		guard.lock();
+		wake.wait_for(guard, std::chrono::seconds(probe_interval),
+				[this]() { return !running || probe_requested; });
+	}
+}
+
+std::vector<std::size_t> MirrorSet::ranking() const {
+	const std::time_t now = std::time(nullptr);
+	auto expected_seconds = [&](const mirror_t& mirror) {
+		const double latency = mirror.latency_ms > 0 ?
+			mirror.latency_ms : unknown_latency_ms;
+		const double throughput = mirror.throughput_bps > 0 ?
+			mirror.throughput_bps : unknown_throughput_bps;
+		return latency / 1000.0 + reference_bytes / throughput;
+	};
+	std::vector<std::size_t> order(mirrors.size());
+	for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		const bool a_down = mirrors[a].retry_after > now;
+		const bool b_down = mirrors[b].retry_after > now;
+		if (a_down != b_down) return b_down;
+		return expected_seconds(mirrors[a]) < expected_seconds(mirrors[b]);
+	});
+	return order;
+}
+
+std::vector<MirrorSet::mirror_t> MirrorSet::ranked() const {
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<mirror_t> result{};
+	for (std::size_t i : ranking()) result.push_back(mirrors[i]);
+	return result;
+}
+
+void MirrorSet::record_success(std::size_t mirror, double latency_ms, double throughput_bps) {
+	std::lock_guard<std::mutex> guard(lock);
+	mirror_t& m = mirrors[mirror];
+	auto blend = [](double average, double sample) {
+		if (sample <= 0) return average;
+		return average > 0 ? average + smoothing * (sample - average) : sample;
+	};
+	m.latency_ms = blend(m.latency_ms, latency_ms);
+	m.throughput_bps = blend(m.throughput_bps, throughput_bps);
+	m.failures = 0;
+	m.retry_after = 0;
+}
+
+void MirrorSet::record_failure(std::size_t mirror) {
+	std::lock_guard<std::mutex> guard(lock);
+	mirror_t& m = mirrors[mirror];
+	m.failures++;
+	// Back off 30s, 60s, 120s... up to half an hour.
+	const int backoff = std::min(30 << std::min(m.failures - 1, 6), 30 * 60);
+	m.retry_after = std::time(nullptr) + backoff;
+}
+
+// Measured from libcurl's timings: time to first byte, then the rate of
+// everything after it.
+static void transfer_timings(CURL* curl, double& latency_ms, double& throughput_bps) {
+	curl_off_t first_byte = 0, total = 0, downloaded = 0;
+	curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+	curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+	curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+	latency_ms = first_byte / 1000.0;
+	const double transfer_seconds = (total - first_byte) / 1e6;
+	throughput_bps = transfer_seconds > 0 && downloaded > 0 ?
+		downloaded / transfer_seconds : 0;
+}
+
+static std::size_t discard_cb(char*, std::size_t size, std::size_t nmemb, void*) {
+	return size * nmemb;
+}
+
+static int probe_xferinfo_cb(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+	return ((std::atomic<bool>*)userp)->load();
+}
+
+void MirrorSet::probe() {
+	TRACE_SCOPE("net.mirror_probe");
+	std::vector<std::string> urls{};
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (const mirror_t& mirror : mirrors)
+			urls.push_back(join_url(mirror.url, probe_path));
+	}
+
+	CURLM* multi = curl_multi_init();
+	if (!multi) return;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		probing = multi;
+	}
+	const std::string range = "0-" + std::to_string(probe_bytes - 1);
+	std::vector<CURL*> handles{};
+	for (std::size_t i = 0; i < urls.size(); i++) {
+		CURL* curl = curl_easy_init();
+		if (!curl) continue;
+		curl_easy_setopt(curl, CURLOPT_URL, urls[i].c_str());
+		curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent);
+		curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+		curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+		curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+		curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)connect_timeout);
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)(connect_timeout + stall_timeout));
+		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_cb);
+		curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+		curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, probe_xferinfo_cb);
+		curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void*)&stopping);
+		curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)i);
+		curl_multi_add_handle(multi, curl);
+		handles.push_back(curl);
+	}
+
+	int active = handles.size();
+	while (active > 0 && !stopping) {
+		curl_multi_perform(multi, &active);
+		int queued;
+		while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+			if (msg->msg != CURLMSG_DONE || stopping) continue;
+			void* data;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &data);
+			const std::size_t mirror = (std::size_t)data;
+			if (msg->data.result == CURLE_OK) {
+				double latency_ms, throughput_bps;
+				transfer_timings(msg->easy_handle, latency_ms, throughput_bps);
+				record_success(mirror, latency_ms, throughput_bps);
+			} else record_failure(mirror);
+			std::lock_guard<std::mutex> guard(lock);
+			mirrors[mirror].last_probe = std::time(nullptr);
+		}
+		if (active > 0) curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		probing = nullptr;
+	}
+	for (CURL* curl : handles) {
+		curl_multi_remove_handle(multi, curl);
+		curl_easy_cleanup(curl);
+	}
+	curl_multi_cleanup(multi);
+}
+
+struct MirrorSet::download_t {
+	FILE* file;
+	std::uintmax_t written;
+	std::uintmax_t total; // 0 until a response has said how long the file is
+	transfer_t* winner;
+	std::size_t source; // mirror the winner came from
+	progress_t* progress;
+	std::chrono::seconds stall_timeout;
+};
+
+struct MirrorSet::transfer_t {
+	download_t* download;
+	std::size_t mirror;
+	CURL* curl;
+	std::uintmax_t offset;
+	std::chrono::steady_clock::time_point last_data;
+	std::uintmax_t range_total; // file length from a "Content-Range: bytes */N"
+	bool checked;
+	bool lost;
+
+	static std::size_t write_cb(char* data, std::size_t size, std::size_t nmemb, void* userp) {
+		transfer_t* transfer = (transfer_t*)userp;
+		download_t* download = transfer->download;
+		const std::size_t bytes = size * nmemb;
+		if (download->winner && download->winner != transfer) {
+			transfer->lost = true;
+			return 0;
+		}
+		if (!transfer->checked) {
+			transfer->checked = true;
+			long code = 0;
+			curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &code);
+			if (transfer->offset != download->written) {
+				// Only a full response can replace what's on disk; a partial
+				// one from the wrong place is useless.
+				if (code == 206) {
+					transfer->lost = true;
+					return 0;
+				}
+				transfer->offset = download->written;
+			}
+			// A server that ignores the Range header sends everything
+			// again, so start the file over.
+			if (transfer->offset > 0 && code != 206) {
+				if (fflush(download->file) != 0 || ftruncate(fileno(download->file), 0) != 0)
+					return 0;
+				rewind(download->file);
+				download->written = 0;
+				transfer->offset = 0;
+			}
+			curl_off_t length = -1;
+			curl_easy_getinfo(transfer->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+			if (length >= 0) {
+				download->total = transfer->offset + length;
+				if (download->progress) download->progress->total_bytes = download->total;
+			}
+			download->winner = transfer;
+			download->source = transfer->mirror;
+		}
+		if (fwrite(data, 1, bytes, download->file) != bytes) return 0;
+		download->written += bytes;
+		transfer->last_data = std::chrono::steady_clock::now();
+		if (download->progress) download->progress->done_bytes = download->written;
+		trace::count(trace::BYTES_DOWNLOADED, bytes);
+		return bytes;
+	}
+
+	// A 416 names the file's length, which is the only way to learn it when
+	// the previous mirror sent everything chunked and then failed.
+	static std::size_t header_cb(char* data, std::size_t size, std::size_t nmemb, void* userp) {
+		transfer_t* transfer = (transfer_t*)userp;
+		std::string header(data, size * nmemb);
+		for (char& c : header) c = tolower(c);
+		const std::string prefix = "content-range: bytes */";
+		if (header.starts_with(prefix))
+			transfer->range_total = std::strtoull(header.c_str() + prefix.size(), nullptr, 10);
+		return size * nmemb;
+	}
+
+	// Aborts a transfer that has gone stall_timeout without sending
+	// anything, whether it never started or stopped partway.
+	static int xferinfo_cb(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+		transfer_t* transfer = (transfer_t*)userp;
+		return std::chrono::steady_clock::now() - transfer->last_data >
+			transfer->download->stall_timeout;
+	}
+};
+
+MirrorSet::result_t MirrorSet::download(const std::string& relative, const path& output,
+		progress_t* progress) {
+	TRACE_SCOPE("net.mirror_download");
+	auto start = std::chrono::steady_clock::now();
+	result_t result{.ok = false, .bytes = 0, .failovers = 0, .seconds = 0};
+
+	std::deque<std::size_t> queue{};
+	std::vector<std::string> urls;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (std::size_t mirror : ranking()) queue.push_back(mirror);
+		for (const mirror_t& mirror : mirrors) urls.push_back(join_url(mirror.url, relative));
+	}
+	if (queue.empty()) {
+		result.error = "No mirrors configured.";
+		return result;
+	}
+
+	FILE* file = fopen(output.c_str(), "wb");
+	if (!file) {
+		result.error = "Could not write " + output.string() + ".";
+		return result;
+	}
+	download_t download{
+		.file = file,
+		.written = 0,
+		.total = 0,
+		.winner = nullptr,
+		.source = 0,
+		.progress = progress,
+		.stall_timeout = std::chrono::seconds(stall_timeout)
+	};
+
+	CURLM* multi = curl_multi_init();
+	std::vector<std::unique_ptr<transfer_t>> active{};
+	auto launch = [&]() -> bool {
+		while (!queue.empty()) {
+			const std::size_t mirror = queue.front();
+			queue.pop_front();
+			CURL* curl = curl_easy_init();
+			if (!curl) continue;
+			auto transfer = std::make_unique<transfer_t>(transfer_t{
+				.download = &download,
+				.mirror = mirror,
+				.curl = curl,
+				.offset = download.written,
+				.last_data = std::chrono::steady_clock::now(),
+				.range_total = 0,
+				.checked = false,
+				.lost = false
+			});
+			curl_easy_setopt(curl, CURLOPT_URL, urls[mirror].c_str());
+			curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent);
+			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+			curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+			curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)connect_timeout);
+			// CURLOPT_RANGE rather than CURLOPT_RESUME_FROM, which gives up on
+			// servers that answer with the whole file.
+			const std::string range = std::to_string(download.written) + "-";
+			if (download.written > 0) curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, transfer_t::write_cb);
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)transfer.get());
+			curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, transfer_t::header_cb);
+			curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void*)transfer.get());
+			curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+			curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, transfer_t::xferinfo_cb);
+			curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void*)transfer.get());
+			curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)transfer.get());
+			curl_multi_add_handle(multi, curl);
+			active.push_back(std::move(transfer));
+			return true;
+		}
+		return false;
+	};
+	auto drop = [&](transfer_t* transfer) {
+		curl_multi_remove_handle(multi, transfer->curl);
+		curl_easy_cleanup(transfer->curl);
+		std::erase_if(active, [&](const auto& t) { return t.get() == transfer; });
+	};
+	// Dropped through no fault of its own: the mirror stays first in line
+	// for a failover.
+	auto retire = [&](transfer_t* transfer) {
+		queue.push_front(transfer->mirror);
+		drop(transfer);
+	};
+
+	launch();
+	// Only the first attempt races; a failover resumes from one mirror.
+	if (race) launch();
+
+	bool done = false;
+	while (!done && !active.empty()) {
+		int running_handles;
+		curl_multi_perform(multi, &running_handles);
+
+		int queued;
+		while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+			if (msg->msg != CURLMSG_DONE) continue;
+			void* data;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &data);
+			transfer_t* transfer = (transfer_t*)data;
+			if (transfer->lost || (download.winner && download.winner != transfer)) {
+				retire(transfer);
+				continue;
+			}
+			if (msg->data.result == CURLE_OK) {
+				double latency_ms, throughput_bps;
+				transfer_timings(transfer->curl, latency_ms, throughput_bps);
+				record_success(transfer->mirror, latency_ms, throughput_bps);
+				result.mirror = urls[transfer->mirror];
+				drop(transfer);
+				done = true;
+				break;
+			}
+			// The previous mirror failed after its last byte, so the failover
+			// asked for a range starting at the end of the file.
+			long code = 0;
+			curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &code);
+			const std::uintmax_t total = transfer->range_total ?
+				transfer->range_total : download.total;
+			if (code == 416 && total > 0 && download.written == total) {
+				result.mirror = urls[download.source];
+				drop(transfer);
+				done = true;
+				break;
+			}
+			record_failure(transfer->mirror);
+			const bool was_winner = download.winner == transfer;
+			if (was_winner) download.winner = nullptr;
+			drop(transfer);
+			// Racers still waiting on their first byte asked for the file from
+			// the start, so they're no use once part of it is on disk.
+			if (download.written > 0)
+				while (!active.empty()) retire(active.back().get());
+			if (active.empty()) {
+				// Mid-transfer failure or nobody left in the race: carry on from
+				// the next mirror, resuming at what's already on disk.
+				if (was_winner) result.failovers++;
+				launch();
+			}
+		}
+
+		// The race is over once someone has sent data.
+		if (!done && download.winner) {
+			for (std::size_t i = 0; i < active.size();) {
+				if (active[i].get() != download.winner) retire(active[i].get());
+				else i++;
+			}
+		}
+
+		if (!done && !active.empty()) curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+	}
+	for (const auto& transfer : active) {
+		curl_multi_remove_handle(multi, transfer->curl);
+		curl_easy_cleanup(transfer->curl);
+	}
+	curl_multi_cleanup(multi);
+	fclose(file);
+
+	result.bytes = download.written;
+	result.seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+	if (!done) {
+		result.error = "Every mirror failed.";
+		std::error_code ec;
+		std::filesystem::remove(output, ec);
+		return result;
+	}
+	result.ok = true;
+	return result;
+}
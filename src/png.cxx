@@ -0,0 +1,119 @@
+#include "png.h"
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+static std::uint32_t read_u32be(const unsigned char* ptr) {
+	return ((std::uint32_t)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+}
+
+static std::uint32_t rgba(unsigned char r, unsigned char g, unsigned char b,
+		unsigned char a) {
+	std::uint32_t pixel;
+	const unsigned char bytes[4] = {r, g, b, a};
+	memcpy(&pixel, bytes, 4);
+	return pixel;
+}
+
+static unsigned char paeth(int a, int b, int c) {
+	const int p = a + b - c;
+	const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+bool decode_png(const unsigned char* data, std::size_t size,
+		std::vector<std::uint32_t>& pixels, int& width, int& height) {
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	if (size < 8 || memcmp(data, signature, 8) != 0) return false;
+
+	int bit_depth = 0, color_type = -1, interlace = 0;
+	unsigned char palette[256][4] = {};
+	std::vector<unsigned char> compressed{};
+	width = height = 0;
+
+	for (std::size_t offset = 8; offset + 12 <= size;) {
+		const std::uint32_t length = read_u32be(data + offset);
+		const unsigned char* type = data + offset + 4;
+		const unsigned char* chunk = data + offset + 8;
+		if (length > size - offset - 12) return false;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+			width = read_u32be(chunk);
+			height = read_u32be(chunk + 4);
+			bit_depth = chunk[8];
+			color_type = chunk[9];
+			interlace = chunk[12];
+		} else if (memcmp(type, "PLTE", 4) == 0) {
+			for (std::uint32_t i = 0; i < length / 3 && i < 256; i++) {
+				memcpy(palette[i], chunk + i * 3, 3);
+				palette[i][3] = 255;
+			}
+		} else if (memcmp(type, "tRNS", 4) == 0 && color_type == 3) {
+			for (std::uint32_t i = 0; i < length && i < 256; i++) palette[i][3] = chunk[i];
+		} else if (memcmp(type, "IDAT", 4) == 0) {
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		} else if (memcmp(type, "IEND", 4) == 0) break;
+		offset += 12 + length;
+	}
+
+	int channels;
+	switch (color_type) {
+	case 0: channels = 1; break;
+	case 2: channels = 3; break;
+	case 3: channels = 1; break;
+	case 4: channels = 2; break;
+	case 6: channels = 4; break;
+	default: return false;
+	}
+	if (bit_depth != 8 || interlace != 0) return false;
+	if (width <= 0 || height <= 0 || width > 4096 || height > 4096) return false;
+
+	const std::size_t stride = (std::size_t)width * channels;
+	std::vector<unsigned char> raw((stride + 1) * height);
+	uLongf raw_size = raw.size();
+	if (uncompress(raw.data(), &raw_size, compressed.data(), compressed.size()) != Z_OK ||
+			raw_size != raw.size())
+		return false;
+
+	// Undo the per-row filters in place.
+	std::vector<unsigned char> previous(stride, 0);
+	for (int y = 0; y < height; y++) {
+		unsigned char* row = raw.data() + y * (stride + 1);
+		const unsigned char filter = row[0];
+		unsigned char* line = row + 1;
+		for (std::size_t x = 0; x < stride; x++) {
+			const int a = x >= (std::size_t)channels ? line[x - channels] : 0;
+			const int b = previous[x];
+			const int c = x >= (std::size_t)channels ? previous[x - channels] : 0;
+			switch (filter) {
+			case 0: break;
+			case 1: line[x] += a; break;
+			case 2: line[x] += b; break;
+			case 3: line[x] += (a + b) / 2; break;
+			case 4: line[x] += paeth(a, b, c); break;
+			default: return false;
+			}
+		}
+		memcpy(previous.data(), line, stride);
+	}
+
+	pixels.resize((std::size_t)width * height);
+	for (int y = 0; y < height; y++) {
+		const unsigned char* line = raw.data() + y * (stride + 1) + 1;
+		std::uint32_t* out = pixels.data() + (std::size_t)y * width;
+		for (int x = 0; x < width; x++) {
+			const unsigned char* px = line + x * channels;
+			switch (color_type) {
+			case 0: out[x] = rgba(px[0], px[0], px[0], 255); break;
+			case 2: out[x] = rgba(px[0], px[1], px[2], 255); break;
+			case 3: out[x] = rgba(palette[px[0]][0], palette[px[0]][1],
+						palette[px[0]][2], palette[px[0]][3]); break;
+			case 4: out[x] = rgba(px[0], px[0], px[0], px[1]); break;
+			case 6: out[x] = rgba(px[0], px[1], px[2], px[3]); break;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,144 @@
+#include "pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <nlohmann/json.hpp>
+using json=nlohmann::json;
+
+static const char* kind_dirs[2] = {"pwads", "iwads"};
+// Coarser than any filesystem we expect to see (FAT keeps 2s mtimes).
+static constexpr auto mtime_granularity = std::chrono::seconds(2);
+
+PoolStack::PoolStack(const path& rootdir) {
+	std::vector<path> roots{rootdir};
+	std::ifstream i(rootdir / "pools.json");
+	if (i.is_open()) {
+		json j = json::parse(i, nullptr, false);
+		if (j.is_array())
+			for (const json& root : j)
+				if (root.is_string()) roots.push_back(path(std::string(root)));
+	}
+	if (const char* env = getenv("DOOM_INSTANCER_POOLS")) {
+		std::stringstream list(env);
+		std::string root;
+		while (std::getline(list, root, ':'))
+			if (!root.empty()) roots.push_back(root);
+	}
+
+	for (const path& root : roots) {
+		const path key = root.lexically_normal();
+		if (std::any_of(stack.begin(), stack.end(), [&](const layer_state_t& layer) {
+				return layer.layer.root == key; }))
+			continue;
+		layer_state_t layer{.layer = {.root = key, .writable = stack.empty()}};
+		layer.directories[PWADS].dir = key / kind_dirs[PWADS];
+		layer.directories[IWADS].dir = key / kind_dirs[IWADS];
+		stack.push_back(std::move(layer));
+	}
+}
+
+bool PoolStack::refresh() {
+	TRACE_SCOPE("pool.refresh");
+	std::lock_guard<std::mutex> guard(lock);
+	bool changed = false;
+	for (KIND kind : {PWADS, IWADS}) {
+		bool kind_changed = false;
+		for (std::size_t layer = 0; layer < stack.size(); layer++)
+			kind_changed |= refresh_directory(kind, layer);
+		if (kind_changed) rebuild_sorted(kind);
+		changed |= kind_changed;
+	}
+	return changed;
+}
+
+void PoolStack::invalidate() {
+	std::lock_guard<std::mutex> guard(lock);
+	for (layer_state_t& layer : stack)
+		for (directory_t& directory : layer.directories) directory.scanned = false;
+}
+
+bool PoolStack::refresh_directory(KIND kind, std::size_t layer) {
+	directory_t& directory = stack[layer].directories[kind];
+	std::error_code ec;
+	// Adding, removing or renaming an entry bumps the directory's mtime,
+	// so an unchanged mtime means an unchanged set of names. That only
+	// holds once the mtime is a full tick older than the scan: a change in
+	// the same tick as the scan leaves the mtime where it was.
+	const auto mtime = std::filesystem::last_write_time(directory.dir, ec);
+	const bool exists = !ec;
+	if (directory.scanned && exists && mtime == directory.mtime &&
+			mtime + mtime_granularity < directory.scanned_at) return false;
+	if (directory.scanned && !exists && directory.names.empty()) return false;
+
+	directory.scanned_at = std::filesystem::file_time_type::clock::now();
+	std::unordered_set<std::string> names{};
+	for (const auto& entry : std::filesystem::directory_iterator(directory.dir, ec))
+		if (!entry.is_directory(ec)) names.insert(entry.path().filename().string());
+	directory.scanned = true;
+	directory.mtime = exists ? mtime : std::filesystem::file_time_type{};
+
+	bool changed = false;
+	std::unordered_map<std::string, std::size_t>& providers = index[kind];
+	for (const std::string& name : directory.names) {
+		if (names.contains(name)) continue;
+		changed = true;
+		auto provider = providers.find(name);
+		if (provider == providers.end() || provider->second != layer) continue;
+		// Fall back to the next layer down that still has it.
+		std::size_t below = layer + 1;
+		while (below < stack.size() && !stack[below].directories[kind].names.contains(name))
+			below++;
+		if (below < stack.size()) provider->second = below;
+		else providers.erase(provider);
+	}
+	for (const std::string& name : names) {
+		if (directory.names.contains(name)) continue;
+		changed = true;
+		auto provider = providers.find(name);
+		if (provider == providers.end()) providers[name] = layer;
+		else provider->second = std::min(provider->second, layer);
+	}
+	directory.names = std::move(names);
+	return changed;
+}
+
+void PoolStack::rebuild_sorted(KIND kind) {
+	std::vector<std::pair<std::string, std::size_t>> entries(index[kind].begin(),
+			index[kind].end());
+	std::sort(entries.begin(), entries.end());
+	sorted[kind].clear();
+	sorted[kind].reserve(entries.size());
+	for (const auto& [name, layer] : entries)
+		sorted[kind].push_back(stack[layer].directories[kind].dir / name);
+}
+
+path PoolStack::resolve(KIND kind, const std::string& name) const {
+	std::lock_guard<std::mutex> guard(lock);
+	auto provider = index[kind].find(name);
+	if (provider == index[kind].end()) return path();
+	return stack[provider->second].directories[kind].dir / name;
+}
+
+std::vector<path> PoolStack::list(KIND kind) const {
+	std::lock_guard<std::mutex> guard(lock);
+	return sorted[kind];
+}
+
+int PoolStack::layer_of(const path& file) const {
+	std::lock_guard<std::mutex> guard(lock);
+	const path dir = file.parent_path();
+	for (std::size_t layer = 0; layer < stack.size(); layer++)
+		for (const directory_t& directory : stack[layer].directories)
+			if (directory.dir == dir) return layer;
+	return -1;
+}
+
+std::vector<PoolStack::layer_t> PoolStack::layers() const {
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<layer_t> layers{};
+	for (const layer_state_t& layer : stack) layers.push_back(layer.layer);
+	return layers;
+}
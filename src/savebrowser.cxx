@@ -0,0 +1,412 @@
+#include "savebrowser.h"
+#include "png.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <zip.h>
+using json=nlohmann::json;
+
+static constexpr int index_version = 1;
+static constexpr std::size_t max_resident_textures = 128;
+static constexpr auto refresh_interval = std::chrono::seconds(1);
+
+SaveBrowser::SaveBrowser() {}
+
+SaveBrowser::~SaveBrowser() {
+	close();
+}
+
+void SaveBrowser::open(const path& dir) {
+	close();
+	instance_dir = dir;
+	saves = scan();
+	refreshed_at = std::chrono::steady_clock::now();
+	load_index();
+
+	stopping = false;
+	worker = std::thread(&SaveBrowser::run, this);
+}
+
+std::vector<SaveBrowser::save_t> SaveBrowser::scan() const {
+	std::vector<save_t> found{};
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(instance_dir / "save", ec)) {
+		if (entry.path().extension() != ".zds") continue;
+		struct stat sb;
+		if (stat(entry.path().c_str(), &sb) != 0) continue;
+		found.push_back({
+			.file = entry.path(),
+			.size = (std::uintmax_t)sb.st_size,
+			.mtime = sb.st_mtime,
+			.indexed = false,
+			.queued = false,
+			.thumb_offset = 0,
+			.thumb_width = 0,
+			.thumb_height = 0,
+			.texture = 0,
+			.last_drawn = 0
+		});
+	}
+	std::sort(found.begin(), found.end(), [](const save_t& a, const save_t& b) {
+		return a.mtime > b.mtime;
+	});
+	return found;
+}
+
+void SaveBrowser::refresh() {
+	const auto now = std::chrono::steady_clock::now();
+	if (instance_dir.empty() || now - refreshed_at < refresh_interval) return;
+	refreshed_at = now;
+	std::vector<save_t> found = scan();
+
+	std::lock_guard<std::mutex> guard(lock);
+	std::unordered_map<std::string, std::size_t> known{};
+	for (std::size_t i = 0; i < saves.size(); i++) known[saves[i].file.filename().string()] = i;
+	auto unchanged = [&](const save_t& save) {
+		auto find = known.find(save.file.filename().string());
+		return find != known.end() && saves[find->second].size == save.size &&
+			saves[find->second].mtime == save.mtime;
+	};
+	if (found.size() == saves.size() && std::all_of(found.begin(), found.end(), unchanged))
+		return;
+
+	std::vector<bool> kept(saves.size(), false);
+	for (save_t& save : found) {
+		if (!unchanged(save)) continue;
+		const std::size_t i = known[save.file.filename().string()];
+		kept[i] = true;
+		save = std::move(saves[i]);
+		save.queued = false;
+	}
+	// Deleted, or rewritten in place like a quicksave or autosave slot.
+	for (std::size_t i = 0; i < saves.size(); i++) {
+		if (kept[i]) continue;
+		if (saves[i].indexed) index_dirty = true;
+		if (saves[i].texture) {
+			glDeleteTextures(1, &saves[i].texture);
+			resident_textures--;
+		}
+	}
+	saves = std::move(found);
+	queue.clear();
+	backlog = 0;
+	generation++;
+	wake.notify_one();
+}
+
+void SaveBrowser::close() {
+	if (worker.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		worker.join();
+	}
+	if (index_dirty) save_index();
+	for (save_t& save : saves)
+		if (save.texture) glDeleteTextures(1, &save.texture);
+	saves.clear();
+	queue.clear();
+	backlog = 0;
+	resident_textures = 0;
+	instance_dir.clear();
+}
+
+std::size_t SaveBrowser::size() {
+	std::lock_guard<std::mutex> guard(lock);
+	return saves.size();
+}
+
+SaveBrowser::row_t SaveBrowser::row(std::size_t i) {
+	std::lock_guard<std::mutex> guard(lock);
+	save_t& save = saves[i];
+	save.last_drawn = frame;
+
+	if (!save.pixels.empty() && !save.texture) {
+		glGenTextures(1, &save.texture);
+		glBindTexture(GL_TEXTURE_2D, save.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, save.thumb_width, save.thumb_height, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, save.pixels.data());
+		save.pixels = {};
+		resident_textures++;
+	}
+
+	const bool needs_thumbnail = save.thumb_width > 0 && !save.texture && save.pixels.empty();
+	if ((!save.indexed || needs_thumbnail) && !save.queued) {
+		save.queued = true;
+		queue.push_front(i);
+		wake.notify_one();
+	}
+
+	return {
+		.name = save.file.filename().string(),
+		.title = save.title,
+		.map = save.map,
+		.time = save.time,
+		.indexed = save.indexed,
+		.texture = save.texture,
+		.thumb_width = save.thumb_width,
+		.thumb_height = save.thumb_height
+	};
+}
+
+void SaveBrowser::end_frame() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (resident_textures > max_resident_textures) {
+		for (save_t& save : saves) {
+			if (!save.texture || save.last_drawn + 1 >= frame) continue;
+			glDeleteTextures(1, &save.texture);
+			save.texture = 0;
+			resident_textures--;
+		}
+	}
+	frame++;
+}
+
+void SaveBrowser::run() {
+	while (true) {
+		std::size_t i;
+		std::uint64_t started;
+		save_t save;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (!stopping && queue.empty()) {
+				while (backlog < saves.size() && saves[backlog].indexed) backlog++;
+				if (backlog < saves.size()) break;
+				if (index_dirty) {
+					guard.unlock();
+					save_index();
+					guard.lock();
+					continue;
+				}
+				wake.wait(guard);
+			}
+			if (stopping) return;
+			if (!queue.empty()) {
+				i = queue.front();
+				queue.pop_front();
+				saves[i].queued = false;
+			} else i = backlog++;
+			started = generation;
+
+			// A row that scrolled out of view before its thumbnail was read
+			// can wait until it is drawn again.
+			const save_t& target = saves[i];
+			const bool wants_thumbnail = target.thumb_width > 0 && !target.texture &&
+				target.pixels.empty() && target.last_drawn + 2 >= frame;
+			if (target.indexed && !wants_thumbnail) continue;
+			save.file = target.file;
+			save.indexed = target.indexed;
+			save.thumb_offset = target.thumb_offset;
+			save.thumb_width = target.thumb_width;
+			save.thumb_height = target.thumb_height;
+		}
+
+		std::vector<std::uint32_t> pixels{};
+		if (save.indexed) {
+			if (!read_thumbnail(save, pixels)) save.thumb_width = save.thumb_height = 0;
+		} else {
+			if (!read_save(save, pixels)) {
+				save.title = "<unreadable>";
+				save.thumb_width = save.thumb_height = 0;
+			}
+			save.thumb_offset = 0;
+			if (!pixels.empty() && !append_thumbnail(pixels, save.thumb_offset)) {
+				pixels.clear();
+				save.thumb_width = save.thumb_height = 0;
+			}
+			if (save.title.empty()) save.title = save.file.stem().string();
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		// refresh() moved the rows meanwhile; a thumbnail appended above is
+		// left for the next compaction.
+		if (generation != started) continue;
+		save_t& target = saves[i];
+		if (!save.indexed) {
+			target.indexed = true;
+			target.title = std::move(save.title);
+			target.map = std::move(save.map);
+			target.time = std::move(save.time);
+			target.thumb_offset = save.thumb_offset;
+			index_dirty = true;
+		}
+		target.thumb_width = save.thumb_width;
+		target.thumb_height = save.thumb_height;
+		// Backlog rows nobody is looking at only needed indexing; their
+		// thumbnail is in saveindex.bin already and is read back when the
+		// row is drawn.
+		if (target.last_drawn + 2 >= frame) target.pixels = std::move(pixels);
+	}
+}
+
+bool SaveBrowser::read_save(save_t& save, std::vector<std::uint32_t>& pixels) {
+	int err;
+	zip_t* z = zip_open(save.file.c_str(), ZIP_RDONLY, &err);
+	if (!z) return false;
+
+	auto read_entry = [&](const char* name, std::vector<unsigned char>& contents) {
+		zip_stat_t sb;
+		zip_stat_init(&sb);
+		if (zip_stat(z, name, 0, &sb) != 0) return false;
+		contents.resize(sb.size);
+		zip_file_t* f = zip_fopen(z, name, 0);
+		if (!f) return false;
+		const bool read_ok = zip_fread(f, contents.data(), sb.size) == (zip_int64_t)sb.size;
+		zip_fclose(f);
+		return read_ok;
+	};
+
+	std::vector<unsigned char> contents{};
+	if (!read_entry("info.json", contents)) {
+		zip_close(z);
+		return false;
+	}
+	json info = json::parse(contents.begin(), contents.end(), nullptr, false);
+	if (info.is_object()) {
+		if (info.contains("Title") && info["Title"].is_string())
+			save.title = info["Title"];
+		if (info.contains("Current Map") && info["Current Map"].is_string())
+			save.map = info["Current Map"];
+		if (info.contains("Creation Time") && info["Creation Time"].is_string())
+			save.time = info["Creation Time"];
+	}
+	if (save.time.empty()) {
+		struct stat sb;
+		if (stat(save.file.c_str(), &sb) == 0) {
+			char timestr[64];
+			std::strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S",
+					std::localtime(&sb.st_mtime));
+			save.time = timestr;
+		}
+	}
+
+	save.thumb_width = save.thumb_height = 0;
+	if (read_entry("savepic.png", contents))
+		if (!decode_png(contents.data(), contents.size(), pixels,
+				save.thumb_width, save.thumb_height)) {
+			pixels.clear();
+			save.thumb_width = save.thumb_height = 0;
+		}
+	zip_close(z);
+	return true;
+}
+
+bool SaveBrowser::read_thumbnail(const save_t& save, std::vector<std::uint32_t>& pixels) {
+	std::ifstream i(instance_dir / "saveindex.bin", std::ios::binary);
+	if (!i.is_open()) return false;
+	pixels.resize((std::size_t)save.thumb_width * save.thumb_height);
+	i.seekg(save.thumb_offset);
+	i.read((char*)pixels.data(), pixels.size() * sizeof(std::uint32_t));
+	if (!i) pixels.clear();
+	return (bool)i;
+}
+
+bool SaveBrowser::append_thumbnail(const std::vector<std::uint32_t>& pixels,
+		std::uint64_t& offset) {
+	std::ofstream o(instance_dir / "saveindex.bin", std::ios::binary | std::ios::app);
+	if (!o.is_open()) return false;
+	o.seekp(0, std::ios::end);
+	const std::streamoff end = o.tellp();
+	if (end < 0) return false;
+	offset = end;
+	o.write((const char*)pixels.data(), pixels.size() * sizeof(std::uint32_t));
+	o.close();
+	return (bool)o;
+}
+
+void SaveBrowser::load_index() {
+	std::ifstream i(instance_dir / "saveindex.json");
+	if (!i.is_open()) return;
+	json j = json::parse(i, nullptr, false);
+	if (!j.is_object() || !j.contains("version") || j["version"] != index_version ||
+			!j.contains("saves") || !j["saves"].is_object()) return;
+
+	const json& indexed = j["saves"];
+	for (save_t& save : saves) {
+		auto find = indexed.find(save.file.filename().string());
+		if (find == indexed.end() || !find->is_object()) continue;
+		const json& entry = *find;
+		if (entry.value("size", (std::uintmax_t)0) != save.size ||
+				entry.value("mtime", (std::int64_t)0) != save.mtime) continue;
+		save.indexed = true;
+		save.title = entry.value("title", "");
+		save.map = entry.value("map", "");
+		save.time = entry.value("time", "");
+		if (entry.contains("thumb") && entry["thumb"].is_array() &&
+				entry["thumb"].size() == 3) {
+			save.thumb_offset = entry["thumb"][0];
+			save.thumb_width = entry["thumb"][1];
+			save.thumb_height = entry["thumb"][2];
+		}
+	}
+}
+
+void SaveBrowser::save_index() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (instance_dir.empty()) return;
+
+	// Thumbnails of deleted or rewritten saves are left behind in the .bin;
+	// once they outweigh the live ones the file gets rewritten.
+	std::uint64_t live_bytes = 0;
+	for (const save_t& save : saves)
+		if (save.indexed)
+			live_bytes += (std::uint64_t)save.thumb_width * save.thumb_height * 4;
+	std::error_code ec;
+	const path bin = instance_dir / "saveindex.bin";
+	const std::uintmax_t bin_bytes = std::filesystem::file_size(bin, ec);
+	if (!ec && bin_bytes > live_bytes * 2 + (1 << 20)) {
+		path compacted = bin;
+		compacted += ".tmp";
+		std::ifstream i(bin, std::ios::binary);
+		std::ofstream o(compacted, std::ios::binary);
+		// The offsets only change once the new file is in place.
+		std::vector<std::uint64_t> offsets(saves.size(), 0);
+		std::vector<char> buffer{};
+		for (std::size_t s = 0; i && o && s < saves.size(); s++) {
+			const save_t& save = saves[s];
+			if (!save.indexed || save.thumb_width == 0) continue;
+			buffer.resize((std::size_t)save.thumb_width * save.thumb_height * 4);
+			i.seekg(save.thumb_offset);
+			i.read(buffer.data(), buffer.size());
+			offsets[s] = o.tellp();
+			o.write(buffer.data(), buffer.size());
+		}
+		o.close();
+		if (i && o) std::filesystem::rename(compacted, bin, ec);
+		if (i && o && !ec) {
+			for (std::size_t s = 0; s < saves.size(); s++)
+				if (saves[s].indexed && saves[s].thumb_width > 0)
+					saves[s].thumb_offset = offsets[s];
+		} else std::filesystem::remove(compacted, ec);
+	}
+
+	json j;
+	j["version"] = index_version;
+	j["saves"] = json::object();
+	for (const save_t& save : saves) {
+		if (!save.indexed) continue;
+		json entry = {
+			{"size", save.size},
+			{"mtime", save.mtime},
+			{"title", save.title},
+			{"map", save.map},
+			{"time", save.time}
+		};
+		if (save.thumb_width > 0)
+			entry["thumb"] = {save.thumb_offset, save.thumb_width, save.thumb_height};
+		j["saves"][save.file.filename().string()] = entry;
+	}
+	std::ofstream o(instance_dir / "saveindex.json");
+	if (!o.is_open()) return;
+	o << j << std::endl;
+	index_dirty = false;
+}
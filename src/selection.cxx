@@ -0,0 +1,69 @@
+#include "selection.h"
+#include <algorithm>
+
+void Selection::reset(std::size_t count) {
+	dense.clear();
+	sparse.assign(count, 0);
+	has_anchor = false;
+}
+
+void Selection::clear() {
+	dense.clear();
+	has_anchor = false;
+}
+
+std::vector<std::size_t> Selection::sorted() const {
+	std::vector<std::size_t> items = dense;
+	std::sort(items.begin(), items.end());
+	return items;
+}
+
+void Selection::set(std::size_t item, bool selected) {
+	if (item >= sparse.size() || contains(item) == selected) return;
+	if (selected) {
+		sparse[item] = dense.size();
+		dense.push_back(item);
+		return;
+	}
+	// Swap with the last one so removal stays O(1).
+	const std::size_t last = dense.back();
+	dense[sparse[item]] = last;
+	sparse[last] = sparse[item];
+	dense.pop_back();
+}
+
+void Selection::click(const std::vector<std::size_t>& visible, std::size_t row,
+		bool ctrl, bool shift) {
+	if (row >= visible.size()) return;
+	const std::size_t item = visible[row];
+	if (shift && has_anchor) {
+		// The anchor may have been filtered out since; then the range
+		// starts at the top of what's shown.
+		auto found = std::find(visible.begin(), visible.end(), anchor);
+		const std::size_t from = found == visible.end() ? 0 : found - visible.begin();
+		if (!ctrl) clear();
+		for (std::size_t i = std::min(from, row); i <= std::max(from, row); i++)
+			set(visible[i], true);
+		anchor = found == visible.end() ? visible[0] : anchor;
+		has_anchor = true;
+		return;
+	}
+	if (ctrl) toggle(item);
+	else {
+		clear();
+		set(item, true);
+	}
+	anchor = item;
+	has_anchor = true;
+}
+
+void Selection::select_all(const std::vector<std::size_t>& visible) {
+	for (std::size_t item : visible) set(item, true);
+}
+
+void Selection::retain(const std::vector<std::size_t>& visible) {
+	// Backwards, so the item swapped into a removed slot was already kept.
+	for (std::size_t k = dense.size(); k-- > 0;)
+		if (!std::binary_search(visible.begin(), visible.end(), dense[k]))
+			set(dense[k], false);
+}
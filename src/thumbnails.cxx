@@ -0,0 +1,433 @@
+#include "thumbnails.h"
+#include "guiconf.h"
+#include "wad.h"
+#include "trace.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <zip.h>
+
+static constexpr std::size_t thumbnail_bytes = THUMBNAIL_SIZE * THUMBNAIL_SIZE;
+static constexpr std::uint32_t atlas_version = 1;
+
+struct map_source_t {
+	std::string name;
+	const unsigned char* data;
+	std::size_t size;
+	std::vector<lump_t> lumps; // the header lump and everything after it
+};
+
+struct map_geometry_t {
+	struct line_t {
+		std::size_t v1;
+		std::size_t v2;
+		bool two_sided;
+	};
+	std::vector<std::pair<float, float>> vertices;
+	std::vector<line_t> lines;
+};
+
+struct ThumbnailCache::job_t {
+	path file;
+	path atlas_file;
+	std::unique_ptr<MappedFile> mapped;
+	// PK3s keep their maps as embedded WADs that have to be inflated first.
+	std::deque<std::vector<unsigned char>> buffers;
+	std::vector<map_source_t> maps;
+	std::shared_ptr<atlas_t> atlas;
+	std::atomic<std::size_t> remaining;
+};
+
+static void find_maps(const unsigned char* data, std::size_t size,
+		std::vector<map_source_t>& maps) {
+	std::vector<lump_t> lumps{};
+	if (!read_wad_directory(data, size, lumps)) return;
+	for (std::size_t i = 0; i+1 < lumps.size(); i++) {
+		if (lumps[i+1].name != "THINGS" && lumps[i+1].name != "TEXTMAP") continue;
+		map_source_t map{.name = lumps[i].name, .data = data, .size = size};
+		map.lumps.push_back(lumps[i]);
+		while (i+1 < lumps.size() && is_map_lump(lumps[i+1].name))
+			map.lumps.push_back(lumps[++i]);
+		maps.push_back(std::move(map));
+	}
+}
+
+static const lump_t* find_lump(const map_source_t& map, const char* name) {
+	for (const lump_t& lump : map.lumps)
+		if (lump.name == name) {
+			if ((std::size_t)lump.offset + lump.size > map.size) return nullptr;
+			return &lump;
+		}
+	return nullptr;
+}
+
+static std::int16_t read_i16(const unsigned char* ptr) {
+	return (std::int16_t)(ptr[0] | (ptr[1] << 8));
+}
+
+static std::uint16_t read_u16(const unsigned char* ptr) {
+	return ptr[0] | (ptr[1] << 8);
+}
+
+static bool binary_geometry(const map_source_t& map, map_geometry_t& geometry) {
+	const lump_t* vertexes = find_lump(map, "VERTEXES");
+	const lump_t* linedefs = find_lump(map, "LINEDEFS");
+	if (!vertexes || !linedefs) return false;
+	const unsigned char* ptr = map.data + vertexes->offset;
+	for (std::size_t i = 0; i < vertexes->size / 4; i++, ptr += 4)
+		geometry.vertices.push_back({read_i16(ptr), read_i16(ptr + 2)});
+
+	// Hexen format linedefs carry five special args and are two bytes longer.
+	const bool hexen = find_lump(map, "BEHAVIOR") != nullptr;
+	const std::size_t stride = hexen ? 16 : 14;
+	const std::size_t back_offset = hexen ? 14 : 12;
+	ptr = map.data + linedefs->offset;
+	for (std::size_t i = 0; i < linedefs->size / stride; i++, ptr += stride) {
+		const std::uint16_t flags = read_u16(ptr + 4);
+		if (flags & 0x80) continue; // ML_DONTDRAW
+		geometry.lines.push_back({
+			.v1 = read_u16(ptr),
+			.v2 = read_u16(ptr + 2),
+			.two_sided = read_u16(ptr + back_offset) != 0xFFFF
+		});
+	}
+	return true;
+}
+
+// Just enough of a UDMF reader to pull vertex positions and linedef
+// endpoints out of a TEXTMAP; everything else is skipped.
+static bool udmf_geometry(const map_source_t& map, map_geometry_t& geometry) {
+	const lump_t* textmap = find_lump(map, "TEXTMAP");
+	if (!textmap) return false;
+	const char* ptr = (const char*)map.data + textmap->offset;
+	const char* end = ptr + textmap->size;
+
+	auto next_token = [&]() -> std::string {
+		while (ptr < end) {
+			if (isspace((unsigned char)*ptr)) ptr++;
+			else if (ptr+1 < end && ptr[0] == '/' && ptr[1] == '/')
+				while (ptr < end && *ptr != '\n') ptr++;
+			else if (ptr+1 < end && ptr[0] == '/' && ptr[1] == '*') {
+				ptr += 2;
+				while (ptr+1 < end && !(ptr[0] == '*' && ptr[1] == '/')) ptr++;
+				ptr += 2;
+			} else break;
+		}
+		if (ptr >= end) return "";
+		const char* start = ptr;
+		if (*ptr == '"') {
+			for (ptr++; ptr < end && *ptr != '"'; ptr++)
+				if (*ptr == '\\') ptr++;
+			ptr = std::min(ptr + 1, end);
+		} else if (strchr("{}=;", *ptr)) ptr++;
+		else while (ptr < end && !isspace((unsigned char)*ptr) && !strchr("{}=;\"", *ptr)) ptr++;
+		return std::string(start, ptr);
+	};
+
+	for (std::string token = next_token(); !token.empty(); token = next_token()) {
+		std::string block = token;
+		for (char& c : block) c = tolower(c);
+		token = next_token();
+		if (token == "=") {
+			while (!token.empty() && token != ";") token = next_token();
+			continue;
+		}
+		if (token != "{") return false;
+
+		double x = 0, y = 0;
+		long v1 = -1, v2 = -1, sideback = -1;
+		for (token = next_token(); !token.empty() && token != "}"; token = next_token()) {
+			std::string key = token;
+			for (char& c : key) c = tolower(c);
+			if (next_token() != "=") return false;
+			const std::string value = next_token();
+			next_token(); // ;
+			if (key == "x") x = strtod(value.c_str(), nullptr);
+			else if (key == "y") y = strtod(value.c_str(), nullptr);
+			else if (key == "v1") v1 = strtol(value.c_str(), nullptr, 10);
+			else if (key == "v2") v2 = strtol(value.c_str(), nullptr, 10);
+			else if (key == "sideback") sideback = strtol(value.c_str(), nullptr, 10);
+		}
+		if (block == "vertex") geometry.vertices.push_back({(float)x, (float)y});
+		else if (block == "linedef" && v1 >= 0 && v2 >= 0)
+			geometry.lines.push_back({
+				.v1 = (std::size_t)v1,
+				.v2 = (std::size_t)v2,
+				.two_sided = sideback >= 0
+			});
+	}
+	return true;
+}
+
+static void rasterise(const map_geometry_t& geometry, unsigned char* pixels) {
+	float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+	for (const auto& line : geometry.lines) {
+		for (std::size_t v : {line.v1, line.v2}) {
+			if (v >= geometry.vertices.size()) continue;
+			min_x = std::min(min_x, geometry.vertices[v].first);
+			max_x = std::max(max_x, geometry.vertices[v].first);
+			min_y = std::min(min_y, geometry.vertices[v].second);
+			max_y = std::max(max_y, geometry.vertices[v].second);
+		}
+	}
+	if (min_x > max_x) return;
+
+	const float margin = 2.0f;
+	const float extent = std::max({max_x - min_x, max_y - min_y, 1.0f});
+	const float scale = (THUMBNAIL_SIZE - 1 - margin * 2) / extent;
+	const float offset_x = margin + ((THUMBNAIL_SIZE - 1 - margin * 2) - (max_x - min_x) * scale) / 2;
+	const float offset_y = margin + ((THUMBNAIL_SIZE - 1 - margin * 2) - (max_y - min_y) * scale) / 2;
+
+	for (const auto& line : geometry.lines) {
+		if (line.v1 >= geometry.vertices.size() || line.v2 >= geometry.vertices.size())
+			continue;
+		// Map y grows upwards, image rows grow downwards.
+		const float x0 = offset_x + (geometry.vertices[line.v1].first - min_x) * scale;
+		const float y0 = THUMBNAIL_SIZE - 1 -
+			(offset_y + (geometry.vertices[line.v1].second - min_y) * scale);
+		const float x1 = offset_x + (geometry.vertices[line.v2].first - min_x) * scale;
+		const float y1 = THUMBNAIL_SIZE - 1 -
+			(offset_y + (geometry.vertices[line.v2].second - min_y) * scale);
+		const unsigned char shade = line.two_sided ? 110 : 255;
+
+		const int steps = std::max(1, (int)std::ceil(std::max(std::abs(x1 - x0),
+				std::abs(y1 - y0))));
+		for (int i = 0; i <= steps; i++) {
+			const int x = (int)std::lround(x0 + (x1 - x0) * i / steps);
+			const int y = (int)std::lround(y0 + (y1 - y0) * i / steps);
+			if (x < 0 || y < 0 || x >= THUMBNAIL_SIZE || y >= THUMBNAIL_SIZE) continue;
+			unsigned char& pixel = pixels[y * THUMBNAIL_SIZE + x];
+			pixel = std::max(pixel, shade);
+		}
+	}
+}
+
+static void atlas_layout(ThumbnailCache::atlas_t& atlas) {
+	atlas.columns = std::max(1, (int)std::ceil(std::sqrt((double)atlas.maps.size())));
+	atlas.rows = std::max(1, ((int)atlas.maps.size() + atlas.columns - 1) / atlas.columns);
+}
+
+ThumbnailCache::ThumbnailCache(const path& cache_dir, HashCache* hashes) :
+		cache_dir(cache_dir), hashes(hashes) {
+	std::error_code ec;
+	std::filesystem::create_directories(cache_dir, ec);
+	const unsigned int count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	for (unsigned int i = 0; i < count; i++)
+		workers.emplace_back(&ThumbnailCache::worker, this);
+}
+
+ThumbnailCache::~ThumbnailCache() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+		tasks.clear();
+	}
+	wake.notify_all();
+	for (std::thread& thread : workers) thread.join();
+	for (auto& [file, atlas] : atlases)
+		if (atlas && atlas->texture) glDeleteTextures(1, &atlas->texture);
+}
+
+void ThumbnailCache::worker() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&]() { return stopping || !tasks.empty(); });
+			if (stopping) return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThumbnailCache::push(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		tasks.push_back(std::move(task));
+	}
+	wake.notify_one();
+}
+
+ThumbnailCache::atlas_t* ThumbnailCache::request(const path& file) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto [find, inserted] = atlases.try_emplace(file.string(), nullptr);
+	if (!inserted) return find->second.get();
+	tasks.push_back([this, file]() { generate(file); });
+	wake.notify_one();
+	return nullptr;
+}
+
+unsigned int ThumbnailCache::texture(atlas_t* atlas) {
+	if (!atlas || atlas->maps.empty()) return 0;
+	if (atlas->texture) return atlas->texture;
+
+	const int width = atlas->columns * THUMBNAIL_SIZE;
+	const int height = atlas->rows * THUMBNAIL_SIZE;
+	std::vector<std::uint32_t> rgba(width * height, 0);
+	for (std::size_t i = 0; i < atlas->maps.size(); i++) {
+		const unsigned char* src = atlas->pixels.data() + i * thumbnail_bytes;
+		const int cell_x = (i % atlas->columns) * THUMBNAIL_SIZE;
+		const int cell_y = (i / atlas->columns) * THUMBNAIL_SIZE;
+		for (int y = 0; y < THUMBNAIL_SIZE; y++)
+			for (int x = 0; x < THUMBNAIL_SIZE; x++) {
+				const std::uint32_t shade = src[y * THUMBNAIL_SIZE + x];
+				rgba[(cell_y + y) * width + cell_x + x] =
+					shade ? (shade << 24) | 0x00FFFFFF : 0;
+			}
+	}
+
+	glGenTextures(1, &atlas->texture);
+	glBindTexture(GL_TEXTURE_2D, atlas->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, rgba.data());
+	return atlas->texture;
+}
+
+void ThumbnailCache::publish(const path& file, std::shared_ptr<atlas_t> atlas) {
+	atlas_layout(*atlas);
+	std::lock_guard<std::mutex> guard(lock);
+	atlases[file.string()] = std::move(atlas);
+}
+
+void ThumbnailCache::generate(const path& file) {
+	TRACE_SCOPE("thumbnails.generate");
+	std::shared_ptr<job_t> job = std::make_shared<job_t>();
+	job->file = file;
+	job->atlas = std::make_shared<atlas_t>();
+	const std::uint64_t hash = hashes->hash(file);
+	if (hash == 0) {
+		publish(file, job->atlas);
+		return;
+	}
+	job->atlas_file = cache_dir / (hash_string(hash) + ".thumbs");
+	if (load_atlas(job->atlas_file, *job->atlas)) {
+		trace::count(trace::CACHE_HITS);
+		publish(file, job->atlas);
+		return;
+	}
+	trace::count(trace::CACHE_MISSES);
+
+	job->mapped = std::make_unique<MappedFile>(file);
+	if (!job->mapped->valid()) {
+		publish(file, job->atlas);
+		return;
+	}
+	const unsigned char* data = job->mapped->data();
+	const std::size_t size = job->mapped->size();
+	if (is_wad(data, size)) find_maps(data, size, job->maps);
+	else {
+		zip_error_t error;
+		zip_error_init(&error);
+		zip_source_t* source = zip_source_buffer_create(data, size, 0, &error);
+		zip_t* z = source ? zip_open_from_source(source, ZIP_RDONLY, &error) : nullptr;
+		if (!z && source) zip_source_free(source);
+		for (zip_int64_t i = 0; z && i < zip_get_num_entries(z, 0); i++) {
+			zip_stat_t sb;
+			zip_stat_init(&sb);
+			if (zip_stat_index(z, i, 0, &sb) != 0) continue;
+			std::string name = sb.name;
+			for (char& c : name) c = tolower(c);
+			if (!name.starts_with("maps/") || !name.ends_with(".wad")) continue;
+
+			zip_file_t* f = zip_fopen_index(z, i, 0);
+			bool read_ok = false;
+			if (f) {
+				std::vector<unsigned char>& buffer = job->buffers.emplace_back(sb.size);
+				read_ok = zip_fread(f, buffer.data(), sb.size) == (zip_int64_t)sb.size;
+				zip_fclose(f);
+				if (read_ok) find_maps(buffer.data(), buffer.size(), job->maps);
+			}
+			if (!read_ok) {
+				// A damaged archive: show nothing this time, but don't cache
+				// a partial atlas under its hash either.
+				zip_close(z);
+				zip_error_fini(&error);
+				publish(file, job->atlas);
+				return;
+			}
+		}
+		if (z) zip_close(z);
+		zip_error_fini(&error);
+	}
+
+	if (job->maps.empty()) {
+		save_atlas(job->atlas_file, *job->atlas);
+		publish(file, job->atlas);
+		return;
+	}
+
+	// One task per map, so a big mapset spreads across the whole pool. The
+	// last one to finish writes the atlas out.
+	job->atlas->pixels.resize(job->maps.size() * thumbnail_bytes, 0);
+	for (const map_source_t& map : job->maps) job->atlas->maps.push_back(map.name);
+	job->remaining = job->maps.size();
+	for (std::size_t i = 0; i < job->maps.size(); i++) {
+		push([this, job, i]() {
+			map_geometry_t geometry{};
+			const map_source_t& map = job->maps[i];
+			if (find_lump(map, "TEXTMAP") ? udmf_geometry(map, geometry) :
+					binary_geometry(map, geometry))
+				rasterise(geometry, job->atlas->pixels.data() + i * thumbnail_bytes);
+			if (--job->remaining != 0) return;
+			save_atlas(job->atlas_file, *job->atlas);
+			publish(job->file, job->atlas);
+		});
+	}
+}
+
+bool ThumbnailCache::load_atlas(const path& atlas_file, atlas_t& atlas) {
+	std::ifstream i(atlas_file, std::ios::binary);
+	if (!i.is_open()) return false;
+	char magic[4];
+	std::uint32_t header[3];
+	i.read(magic, 4);
+	i.read((char*)header, sizeof(header));
+	if (!i || memcmp(magic, "DITH", 4) != 0 || header[0] != atlas_version ||
+			header[1] != THUMBNAIL_SIZE) return false;
+	// Every map takes at least a length byte and its pixels, so a corrupt
+	// count can't make us allocate more than the file could hold.
+	std::error_code ec;
+	const std::uintmax_t file_size = std::filesystem::file_size(atlas_file, ec);
+	if (ec || header[2] > file_size / (1 + thumbnail_bytes)) return false;
+
+	atlas.maps.resize(header[2]);
+	for (std::string& map : atlas.maps) {
+		unsigned char length = 0;
+		i.read((char*)&length, 1);
+		map.resize(length);
+		i.read(map.data(), length);
+	}
+	atlas.pixels.resize(atlas.maps.size() * thumbnail_bytes);
+	i.read((char*)atlas.pixels.data(), atlas.pixels.size());
+	return (bool)i;
+}
+
+void ThumbnailCache::save_atlas(const path& atlas_file, const atlas_t& atlas) {
+	path temp = atlas_file;
+	temp += ".tmp";
+	std::ofstream o(temp, std::ios::binary);
+	if (!o.is_open()) return;
+	const std::uint32_t header[3] = {
+		atlas_version, THUMBNAIL_SIZE, (std::uint32_t)atlas.maps.size()
+	};
+	o.write("DITH", 4);
+	o.write((const char*)header, sizeof(header));
+	for (const std::string& map : atlas.maps) {
+		const unsigned char length = std::min<std::size_t>(map.size(), 255);
+		o.write((const char*)&length, 1);
+		o.write(map.data(), length);
+	}
+	o.write((const char*)atlas.pixels.data(), atlas.pixels.size());
+	o.close();
+	std::error_code ec;
+	if (o) std::filesystem::rename(temp, atlas_file, ec);
+	else std::filesystem::remove(temp, ec);
+}
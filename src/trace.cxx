@@ -0,0 +1,242 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+using json=nlohmann::json;
+
+namespace trace {
+	std::atomic<bool> enabled = false;
+	std::atomic<std::uint64_t> counters[COUNTER_COUNT] = {};
+}
+
+namespace {
+	// Oldest events are overwritten once the buffer is full, so a trace
+	// left running only ever holds the most recent activity.
+	constexpr std::size_t max_events = 1 << 18;
+	// Percentiles are taken over each operation's most recent samples.
+	constexpr std::size_t max_samples = 1024;
+
+	struct event_t {
+		const char* name;
+		std::uint64_t start;
+		std::uint64_t duration;
+		std::uint32_t thread;
+	};
+
+	struct timing_t {
+		std::uint64_t count = 0;
+		std::uint64_t total = 0;
+		std::uint64_t max = 0;
+		std::vector<std::uint64_t> samples{};
+		std::size_t next_sample = 0;
+	};
+
+	struct state_t {
+		std::mutex lock;
+		std::vector<event_t> events;
+		std::size_t next_event = 0;
+		std::unordered_map<const char*, timing_t> operations;
+	};
+
+	// Never destroyed: spans can still close on worker threads while
+	// static destructors run at exit.
+	state_t& state() {
+		static state_t* state = new state_t();
+		return *state;
+	}
+
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	std::uint32_t thread_id() {
+		static std::atomic<std::uint32_t> next_thread = 1;
+		thread_local const std::uint32_t id = next_thread++;
+		return id;
+	}
+
+	double milliseconds(std::uint64_t nanoseconds) {
+		return nanoseconds / 1e6;
+	}
+}
+
+void trace::set_enabled(bool enable) {
+	enabled = enable;
+}
+
+void trace::clear() {
+	state_t& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	s.events.clear();
+	s.next_event = 0;
+	s.operations.clear();
+	for (std::atomic<std::uint64_t>& counter : counters) counter = 0;
+}
+
+const char* trace::counter_name(counter_t counter) {
+	switch (counter) {
+		case BYTES_DOWNLOADED: return "Bytes Downloaded";
+		case CACHE_HITS: return "Cache Hits";
+		case CACHE_MISSES: return "Cache Misses";
+		case ALLOCATIONS: return "Allocations";
+		case ALLOCATED_BYTES: return "Allocated Bytes";
+		default: return "";
+	}
+}
+
+std::uint64_t trace::now() {
+	// Never 0, which Scope uses to mean "not recording".
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - epoch).count() + 1;
+}
+
+void trace::record(const char* name, std::uint64_t start, std::uint64_t end) {
+	const event_t event{
+		.name = name,
+		.start = start,
+		.duration = end - start,
+		.thread = thread_id()
+	};
+	state_t& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	if (s.events.size() < max_events) s.events.push_back(event);
+	else s.events[s.next_event] = event;
+	s.next_event = (s.next_event + 1) % max_events;
+
+	timing_t& operation = s.operations[name];
+	operation.count++;
+	operation.total += event.duration;
+	operation.max = std::max(operation.max, event.duration);
+	if (operation.samples.size() < max_samples) operation.samples.push_back(event.duration);
+	else operation.samples[operation.next_sample] = event.duration;
+	operation.next_sample = (operation.next_sample + 1) % max_samples;
+}
+
+std::vector<trace::operation_t> trace::operations() {
+	// The same name can show up under more than one pointer if the literal
+	// lives in several translation units, so merge by string.
+	std::map<std::string, ::timing_t> merged{};
+	{
+		state_t& s = state();
+		std::lock_guard<std::mutex> guard(s.lock);
+		for (const auto& [name, operation] : s.operations) {
+			::timing_t& into = merged[name];
+			into.count += operation.count;
+			into.total += operation.total;
+			into.max = std::max(into.max, operation.max);
+			into.samples.insert(into.samples.end(),
+					operation.samples.begin(), operation.samples.end());
+		}
+	}
+
+	std::vector<trace::operation_t> result{};
+	for (auto& [name, operation] : merged) {
+		std::vector<std::uint64_t>& samples = operation.samples;
+		auto percentile = [&](double p) -> double {
+			if (samples.empty()) return 0;
+			auto nth = samples.begin() + std::min<std::size_t>(samples.size() - 1,
+					p * samples.size());
+			std::nth_element(samples.begin(), nth, samples.end());
+			return milliseconds(*nth);
+		};
+		result.push_back({
+			.name = name,
+			.count = operation.count,
+			.total_ms = milliseconds(operation.total),
+			.p50_ms = percentile(0.50),
+			.p99_ms = percentile(0.99),
+			.max_ms = milliseconds(operation.max)
+		});
+	}
+	return result;
+}
+
+std::size_t trace::event_count() {
+	state_t& s = state();
+	std::lock_guard<std::mutex> guard(s.lock);
+	return s.events.size();
+}
+
+bool trace::export_chrome(const path& file) {
+	std::vector<event_t> events{};
+	{
+		state_t& s = state();
+		std::lock_guard<std::mutex> guard(s.lock);
+		events.reserve(s.events.size());
+		// Oldest first once the buffer has wrapped.
+		const std::size_t first = s.events.size() < max_events ? 0 : s.next_event;
+		for (std::size_t i = 0; i < s.events.size(); i++)
+			events.push_back(s.events[(first + i) % s.events.size()]);
+	}
+
+	const int pid = getpid();
+	json trace_events = json::array();
+	for (const event_t& event : events) {
+		trace_events.push_back({
+			{"name", event.name},
+			{"cat", "doom_instancer"},
+			{"ph", "X"},
+			{"ts", event.start / 1000.0},
+			{"dur", event.duration / 1000.0},
+			{"pid", pid},
+			{"tid", event.thread}
+		});
+	}
+	json args = json::object();
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		args[counter_name((counter_t)i)] = counters[i].load();
+	trace_events.push_back({
+		{"name", "Counters"},
+		{"ph", "C"},
+		{"ts", now() / 1000.0},
+		{"pid", pid},
+		{"args", args}
+	});
+
+	std::error_code ec;
+	std::filesystem::create_directories(file.parent_path(), ec);
+	std::ofstream o(file);
+	if (!o.is_open()) return false;
+	o << json{{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}} << std::endl;
+	return o.good();
+}
+
+// Counting allocations needs the global allocator; everything else in the
+// program allocates through these. Kept out of line so GCC doesn't pair the
+// inlined free() with a new-expression and warn about a mismatch.
+[[gnu::noinline]] void* operator new(std::size_t size) {
+	trace::count(trace::ALLOCATIONS);
+	trace::count(trace::ALLOCATED_BYTES, size);
+	if (size == 0) size = 1;
+	while (true) {
+		if (void* memory = std::malloc(size)) return memory;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) throw std::bad_alloc();
+		handler();
+	}
+}
+
+[[gnu::noinline]] void* operator new[](std::size_t size) {
+	return ::operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
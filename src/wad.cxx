@@ -0,0 +1,96 @@
+#include "wad.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zip.h>
+
+MappedFile::MappedFile(const path& file) {
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return;
+	struct stat sb;
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+		void* ptr = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr != MAP_FAILED) {
+			data_ptr = (const unsigned char*)ptr;
+			data_size = sb.st_size;
+		}
+	}
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (data_ptr) munmap((void*)data_ptr, data_size);
+}
+
+static std::uint32_t read_u32(const unsigned char* ptr) {
+	return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((std::uint32_t)ptr[3] << 24);
+}
+
+bool is_wad(const unsigned char* data, std::size_t size) {
+	if (size < 12) return false;
+	return memcmp(data, "IWAD", 4) == 0 || memcmp(data, "PWAD", 4) == 0;
+}
+
+bool read_wad_directory(const unsigned char* data, std::size_t size,
+		std::vector<lump_t>& lumps) {
+	if (!is_wad(data, size)) return false;
+	const std::uint32_t num_lumps = read_u32(data + 4);
+	const std::uint32_t dir_offset = read_u32(data + 8);
+	if (dir_offset > size || (size - dir_offset) / 16 < num_lumps) return false;
+
+	lumps.reserve(lumps.size() + num_lumps);
+	const unsigned char* entry = data + dir_offset;
+	for (std::uint32_t i = 0; i < num_lumps; i++, entry += 16) {
+		lump_t lump{
+			.offset = read_u32(entry),
+			.size = read_u32(entry + 4)
+		};
+		const char* name = (const char*)entry + 8;
+		lump.name.assign(name, strnlen(name, 8));
+		for (char& c : lump.name) c = toupper(c);
+		lumps.push_back(std::move(lump));
+	}
+	return true;
+}
+
+bool read_pk3_directory(const unsigned char* data, std::size_t size,
+		std::vector<std::string>& entries) {
+	zip_error_t error;
+	zip_error_init(&error);
+	zip_source_t* source = zip_source_buffer_create(data, size, 0, &error);
+	if (!source) {
+		zip_error_fini(&error);
+		return false;
+	}
+	zip_t* z = zip_open_from_source(source, ZIP_RDONLY, &error);
+	if (!z) {
+		zip_source_free(source);
+		zip_error_fini(&error);
+		return false;
+	}
+
+	const zip_int64_t num_entries = zip_get_num_entries(z, 0);
+	entries.reserve(entries.size() + num_entries);
+	for (zip_int64_t i = 0; i < num_entries; i++) {
+		const char* name = zip_get_name(z, i, 0);
+		if (!name || !*name || name[strlen(name)-1] == '/') continue;
+		entries.push_back(name);
+	}
+	zip_close(z);
+	zip_error_fini(&error);
+	return true;
+}
+
+bool is_map_lump(const std::string& name) {
+	static const char* map_lumps[] = {
+		"THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS", "SSECTORS",
+		"NODES", "SECTORS", "REJECT", "BLOCKMAP", "BEHAVIOR", "SCRIPTS",
+		"TEXTMAP", "ZNODES", "DIALOGUE", "ENDMAP", "LEAFS", "LIGHTS",
+		"MACROS", "GL_VERT", "GL_SEGS", "GL_SSECT", "GL_NODES", "GL_PVS",
+	};
+	for (const char* map_lump : map_lumps)
+		if (name == map_lump) return true;
+	return false;
+}